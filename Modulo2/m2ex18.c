@@ -24,6 +24,15 @@ void Config_Port_Mapping(); // NEW FUNCTION
 #define PWM_PERIOD 1000
 #define PWM_STEP   125
 
+// --- RUN FROM RAM ---
+// The capture ISR runs on every IR edge. With the TI compiler it is placed in
+// .TI.ramfunc (linker: .TI.ramfunc : {} load=FLASH, run=RAM, table(BINIT)).
+#if defined(__TI_COMPILER_VERSION__)
+#define RAMFUNC __attribute__((ramfunc))
+#else
+#define RAMFUNC
+#endif
+
 volatile unsigned int lastCapture = 0;
 volatile unsigned int pulseWidth = 0;
 volatile uint32_t command = 0;
@@ -117,7 +126,7 @@ void ConfigureLeds()
 
 // --- IR SENSOR INTERRUPT ---
 #pragma vector = TIMER0_A1_VECTOR
-__interrupt void Timer0_A1_ISR(void)
+RAMFUNC __interrupt void Timer0_A1_ISR(void)
 {
     unsigned int capture = TA0CCR1;
     pulseWidth = capture - lastCapture;
@@ -1,6 +1,7 @@
 #include <msp430.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
 
@@ -9,22 +10,412 @@
 
 /* * NOVAS VARIÁVEIS GLOBAIS * */
 // Usamos uint8_t para economizar RAM (0 a 100 cabe em 8 bits)
+// Buffer circular: history_index é a próxima posição (a mais antiga quando cheio)
 uint8_t moisture_history[HISTORY_SIZE]; 
+uint32_t history_tick[HISTORY_SIZE];    // Instante de cada leitura (STATS_TICK_S desde o boot)
 unsigned int history_index = 0;         // Aponta para a posição atual do vetor
+uint8_t history_count = 0;
+uint32_t history_clock_s = 0;           // Soma dos intervalos dormidos
 
+/* * ESTATÍSTICAS DA JANELA (O(1) por leitura) * */
+// Somas para média e mínimos quadrados com x = idade em ticks de
+// STATS_TICK_S relativa à leitura mais recente (x <= 0). A cada leitura as
+// idades são deslocadas algebricamente em vez de recalculadas. O tick é o
+// menor intervalo adaptativo; com leituras até 65535 s uma da outra,
+// |x| <= 2530 e n·Σx² fica abaixo de 3,7e9: tudo cabe em 32 bits.
+#define STATS_TICK_S  600
+uint16_t stats_sum_y = 0;
+int32_t  stats_sum_x = 0;
+uint32_t stats_sum_xx = 0;
+int32_t  stats_sum_xy = 0;
+
+// Filas monotônicas de posições do buffer: a frente é o mínimo (máximo) da
+// janela. Cada posição entra e sai uma vez, O(1) amortizado.
+uint8_t stats_min_q[HISTORY_SIZE];
+uint8_t stats_min_head = 0, stats_min_len = 0;
+uint8_t stats_max_q[HISTORY_SIZE];
+uint8_t stats_max_head = 0, stats_max_len = 0;
+
+#define TREND_STABLE  5  // |tendência| abaixo de 0,5 %/h é mostrada como estável
+
+/* * ARQUIVO EM TRÊS RESOLUÇÕES * */
+// Além da janela acima, cada leitura da zona 0 alimenta um arquivo de
+// meses: médias horárias das últimas ARCH_HOURS horas, média/mínimo/máximo
+// diários dos últimos ARCH_DAYS dias e semanais das últimas ARCH_WEEKS
+// semanas. Horas, dias e semanas são de 24 h e 7 dias contados no relógio
+// do histórico (não há calendário); uma hora sem leitura repete a última.
+//
+// Cada nível fecha incrementalmente: a hora fecha na primeira leitura da
+// hora seguinte, e 24 horas fechadas viram um dia, 7 dias uma semana. O
+// registro guardado é a média como delta (módulo 256) da média anterior em
+// zig-zag e, nos dias e semanas, as distâncias da média ao mínimo e ao
+// máximo. Cada valor ocupa um nibble (0 a 14) ou três (15 + um byte): uma
+// média que muda mais de 7 pontos ou um mínimo/máximo a 15 pontos da média
+// já usa o escape, o que é comum com as regas. Cada anel é dimensionado
+// para o pior caso, todos os campos com escape (3 nibbles por campo), e
+// guarda sempre ARCH_HOURS/ARCH_DAYS/ARCH_WEEKS registros: 72 + 270 + 117
+// = 459 bytes de RAM, mais ~40 de estado. Com a umidade estável bastaria
+// ~1/3 disso.
+#define ARCH_HOUR  0
+#define ARCH_DAY   1
+#define ARCH_WEEK  2
+#define ARCH_TIERS 3
+
+#define ARCH_HOURS         48
+#define ARCH_DAYS          60
+#define ARCH_WEEKS         26
+#define ARCH_ESCAPE        15   // Nibble que anuncia um byte inteiro
+#define ARCH_WORST         3    // Nibbles de um campo com escape
+
+// Anel de cada nível, dois nibbles por byte
+#define ARCH_HOUR_BYTES    ((ARCH_HOURS * 1 * ARCH_WORST + 1) / 2)
+#define ARCH_DAY_BYTES     ((ARCH_DAYS * 3 * ARCH_WORST + 1) / 2)
+#define ARCH_WEEK_BYTES    ((ARCH_WEEKS * 3 * ARCH_WORST + 1) / 2)
+
+typedef struct
+{
+    uint8_t *nib;     // Nibbles, o primeiro de cada byte na metade alta
+    uint16_t size;    // Capacidade em nibbles
+    uint16_t tail;    // Primeiro nibble do registro mais antigo
+    uint16_t used;    // Nibbles ocupados
+    uint8_t count;    // Registros guardados
+    uint8_t limit;    // Registros no máximo
+    uint8_t fields;   // 1 (média) ou 3 (média, abaixo, acima)
+    uint8_t first;    // Média do mais antigo (o delta dele não tem referência)
+    uint8_t last;     // Média do mais recente: referência do próximo delta
+} arch_ring_t;
+
+// Acumulador do período aberto de cada nível
+typedef struct
+{
+    uint16_t sum;     // Soma das médias dos períodos de baixo
+    uint8_t n;
+    uint8_t min, max;
+} arch_acc_t;
+
+uint8_t arch_hour_nib[ARCH_HOUR_BYTES];
+uint8_t arch_day_nib[ARCH_DAY_BYTES];
+uint8_t arch_week_nib[ARCH_WEEK_BYTES];
+
+arch_ring_t arch[ARCH_TIERS] = {
+    { arch_hour_nib, 2 * ARCH_HOUR_BYTES, 0, 0, 0, ARCH_HOURS, 1, 0, 0 },
+    { arch_day_nib,  2 * ARCH_DAY_BYTES,  0, 0, 0, ARCH_DAYS,  3, 0, 0 },
+    { arch_week_nib, 2 * ARCH_WEEK_BYTES, 0, 0, 0, ARCH_WEEKS, 3, 0, 0 },
+};
+arch_acc_t arch_acc[ARCH_TIERS];
+const uint8_t arch_span[ARCH_TIERS] = { 0, 24, 7 };  // Períodos de baixo por período
+uint32_t arch_hour = 0;     // Hora aberta (relógio do histórico / 3600)
+uint8_t arch_held = 0;      // Última leitura, repetida nas horas sem leitura
+bool arch_started = false;
+
+
+/* * INTERVALO DE AMOSTRAGEM ADAPTATIVO * */
+// O próximo despertar sai da distância ao limiar e da tendência da umidade:
+// perto do limiar (ou indo rápido até ele) amostra mais, longe e estável
+// dorme até SAMPLE_MAX_S.
+#ifndef SAMPLE_MIN_S
+#define SAMPLE_MIN_S        600    // 10 min
+#endif
+#ifndef SAMPLE_MAX_S
+#define SAMPLE_MAX_S        14400  // 4 h
+#endif
+#define SAMPLE_S_PER_PCT    600    // Intervalo extra por ponto de distância ao limiar
+#define MOISTURE_THRESHOLD  30     // Limiar padrão das zonas (%)
+#define DRY_PATIENCE_S      14400  // Seco por 4 h antes de irrigar
+
+uint16_t sample_interval_s = SAMPLE_MAX_S;  // Intervalo dormido antes desta leitura
 
 /* * DEFINIÇÕES DE HARDWARE 
  */
-// Relé / Bomba (P2.0) para transitor que liga bomba
-#define PUMP_PIN    BIT0 // pino bomba
-#define PLED_PIN    BIT0 // pino led indicativo
+#define PLED_PIN    BIT0 // pino led indicativo (P1.0): alguma bomba ligada
 
-// Sensor de Umidade (Leitura em P6.0)
-#define SENSOR_PIN  BIT0
-
-// Alimentação do Sensor (P6.1 - VCC Controlado)
+// Alimentação dos sensores (P6.1 - VCC Controlado, comum a todas as zonas)
 #define SENSOR_PWR_PIN  BIT1
 
+// Botões do LaunchPad, com pull-up: S1 em P2.1 e S2 em P1.1
+#define BTN_S1_PIN  BIT1  // P2.1
+#define BTN_S2_PIN  BIT1  // P1.1
+
+/* * ZONAS DE IRRIGAÇÃO * */
+// Cada zona tem seu sensor (entrada analógica em P6.x), sua bomba (pino de
+// P2 para o transistor), seu limiar e seu estado de seca e de rega. A1 fica
+// de fora: P6.1 alimenta os sensores. Só a zona 0 tem PWM (TA1.1 em P2.0,
+// partida suave); as demais ligam a bomba por GPIO, e o escalonamento por
+// corrente (abaixo) evita que duas partidas se somem.
+// O histórico, o log na flash e a telemetria acompanham a zona 0.
+#ifndef ZONES
+#define ZONES 1   // 1 a 4
+#endif
+#if ZONES < 1 || ZONES > 4
+#error "ZONES deve ficar entre 1 e 4"
+#endif
+
+typedef struct
+{
+    uint8_t inch;       // Canal do ADC (ADC12INCH_x), pino P6.x
+    uint8_t pump_pin;   // Bit em P2
+    uint8_t pwm;        // 1 = pino é TA1.1 (PWM), 0 = GPIO
+    uint8_t threshold;  // Abaixo disso o solo está seco (%)
+} zone_cfg_t;
+
+const zone_cfg_t zone_cfg[ZONES] = {
+    { 0, BIT0, 1, MOISTURE_THRESHOLD },  // A0 (P6.0), bomba em P2.0 (TA1.1)
+#if ZONES > 1
+    { 2, BIT2, 0, MOISTURE_THRESHOLD },  // A2 (P6.2), bomba em P2.2
+#endif
+#if ZONES > 2
+    { 3, BIT3, 0, MOISTURE_THRESHOLD },  // A3 (P6.3), bomba em P2.3
+#endif
+#if ZONES > 3
+    { 4, BIT4, 0, MOISTURE_THRESHOLD },  // A4 (P6.4), bomba em P2.4
+#endif
+};
+
+/* * BOMBA: PWM COM PARTIDA SUAVE E DOSE PI * */
+// P2.0 é a saída TA1.1: PWM de 128 Hz a partir do ACLK (Reset/Set,
+// OUTMOD_7, como no Modulo2/m2ex09.c), que continua rodando em LPM3. A
+// bomba sobe em PUMP_RAMP_STEPS degraus até PUMP_DUTY_PCT em vez de partir
+// a pleno.
+#define PUMP_PERIOD       255   // TA1CCR0: 32768 / 256 = 128 Hz
+#ifndef PUMP_DUTY_PCT
+#define PUMP_DUTY_PCT     80    // Ciclo de trabalho em regime
+#endif
+#define PUMP_RAMP_STEPS   8
+#define PUMP_RAMP_MS      125   // 1 s de rampa
+
+// Dose em regime (décimos de segundo) = Kp * déficit + Ki * acumulado, com
+// déficit = alvo da zona - umidade. O acumulado soma o déficit de cada rega
+// (solo que não respondeu à dose anterior pede mais) e é descontado pelas
+// leituras acima do alvo; fica em [0, PUMP_INTEGRAL_MAX] (antiwindup).
+#define PUMP_MARGIN        6     // Alvo = limiar da zona + margem (%)
+#define PUMP_KP_DS         6     // ds por ponto de déficit
+#define PUMP_KI_DS         2     // ds por ponto acumulado
+#define PUMP_DOSE_MIN_DS   10    // 1 s
+#define PUMP_DOSE_MAX_DS   100   // 10 s
+#define PUMP_INTEGRAL_MAX  40
+
+// Corrente de pico: uma bomba só parte se a soma das que já estão ligadas
+// (em regime) mais a dela couber em PUMP_CURRENT_LIMIT_MA; senão espera uma
+// delas desligar. Com os valores padrão as bombas regam uma de cada vez.
+#ifndef PUMP_CURRENT_MA
+#define PUMP_CURRENT_MA        180   // Uma bomba a pleno
+#endif
+#ifndef PUMP_CURRENT_LIMIT_MA
+#define PUMP_CURRENT_LIMIT_MA  250
+#endif
+
+uint16_t pump_current_ma = 0;  // Soma das bombas ligadas
+
+// Estados da tarefa da bomba
+#define PUMP_IDLE  0
+#define PUMP_WAIT  1   // Rega pedida, esperando folga de corrente
+#define PUMP_RAMP  2   // Subindo o ciclo de trabalho
+#define PUMP_HOLD  3   // Dose em regime
+
+/* * ESTADO DAS ZONAS * */
+typedef struct
+{
+    uint8_t pct;            // Última umidade lida (%)
+    bool dry_streak;
+    uint32_t dry_seconds;   // Tempo seco desde a primeira leitura seca
+    int16_t pump_integral;  // Acumulado da lei PI
+    uint8_t pump_state;
+    uint8_t pump_step;      // Degraus da rampa já aplicados
+    uint16_t pump_dose_ds;  // Dose da rega em andamento
+} zone_t;
+
+zone_t zones[ZONES];
+
+/* * ESCALONADOR COOPERATIVO SEM TICK * */
+// Cada função do controlador é uma tarefa curta que roda até o fim. Uma
+// tarefa fica pronta quando vence o prazo dela (fila ordenada por instante)
+// ou quando alguém posta um evento para ela (inclusive uma ISR). Sem tarefa
+// pronta a CPU dorme no LPM mais fundo que o hardware em uso permite: LPM3
+// com o RTC_A programado para estourar no próximo prazo, ou LPM0 enquanto a
+// fila do I2C (SMCLK) não esvazia. Não há interrupção periódica.
+//
+// O tempo do escalonador conta ciclos de ACLK (32768 por segundo) em 32
+// bits: dá a volta em ~36 h, então os prazos ficam a menos de 18 h do agora
+// e são comparados pela diferença com sinal.
+#define SCHED_TICKS_PER_S  32768UL
+#define SCHED_MS(ms)       ((uint32_t)(ms) * SCHED_TICKS_PER_S / 1000)
+#define SCHED_NONE         0xFF
+
+// Tarefas; com várias prontas, a de menor número roda primeiro
+#define TASK_SENSE      0   // Leitura, decisão e agenda da próxima leitura
+#define TASK_DISPLAY    1   // Atualiza o LCD conforme display_mode
+#define TASK_TELEMETRY  2   // Quadro de telemetria (TELEMETRY_ENABLE)
+#define TASK_SERVICE    3   // Contadores de energia e perfilamento
+#define TASK_BACKLIGHT  4   // Botões e prazos da luz de fundo
+#define TASK_WATCH      5   // Pulso de vigília do Comparator_B
+#define TASK_PUMP       6   // Rampa, dose e parada da bomba: uma por zona
+#define TASKS           (TASK_PUMP + ZONES)  // Até 16 (um bit de sched_ready)
+
+volatile uint16_t sched_ready = 0; // Um bit por tarefa pronta
+uint32_t sched_deadline[TASKS];
+uint8_t sched_next[TASKS];         // Fila de prazos: lista ligada ordenada
+uint8_t sched_head = SCHED_NONE;
+uint32_t sched_epoch = 0;          // Agora = sched_epoch + contador do RTC
+uint32_t sched_armed = 0;          // Instante do próximo estouro do RTC
+
+// Telas da tarefa do display
+#define DISPLAY_ENERGY    0   // Contadores acumulados (após o boot)
+#define DISPLAY_MOISTURE  1   // display_label + umidade e estatísticas
+#define DISPLAY_PUMPING   2
+
+uint8_t display_mode = DISPLAY_ENERGY;
+const char *display_label = "";
+
+/* * TEMPORIZADORES VIRTUAIS (TIMER_A2) * */
+// O TA2 conta ACLK em modo contínuo e nunca é reprogramado: é a base de
+// tempo das esperas curtas. Cada usuário tem um temporizador virtual com
+// prazo próprio; os pendentes ficam numa lista ordenada e o TA2CCR0 segue
+// sempre o primeiro. Esperas sobrepostas não se atrapalham, e TA0/TA1 ficam
+// livres para PWM e captura.
+//
+// A parte alta do tempo conta os estouros do TA2 (a cada 2 s), mas o TAIE só
+// fica ligado com algum prazo pendente: sem esperas, o TA2 não interrompe.
+#define VTIMER_NONE   0xFF
+
+#define VTIMER_WAIT   0   // Enter_Assistive_Wait_ms
+#define VTIMER_DELAY  1   // Delay_us_Custom
+#define VTIMERS       2   // Até 8 (um bit de vtimer_fired)
+
+volatile uint8_t vtimer_fired = 0;  // Um bit por temporizador vencido
+uint32_t vtimer_deadline[VTIMERS];
+uint8_t vtimer_next[VTIMERS];       // Lista ligada ordenada por prazo
+uint8_t vtimer_head = VTIMER_NONE;
+volatile uint16_t vtimer_overflows = 0;
+
+/* * AQUISIÇÃO DO ADC (rajada sobreamostrada) * */
+// Uma leitura = ADC_SAMPLES conversões do canal de cada zona, todas numa
+// única sequência de hardware (ADC12CONSEQ_1): a zona z ocupa
+// ADC12MEM[z * ADC_SAMPLES] em diante. Cada grupo é reduzido por um filtro.
+// Os ajustes podem ser sobrescritos com -D (ex.: pelo benchmark em host/).
+#ifndef ADC_SAMPLES
+#if ZONES > 2
+#define ADC_SAMPLES         (16 / ZONES)
+#else
+#define ADC_SAMPLES         8   // Por zona; ZONES * ADC_SAMPLES <= 16
+#endif
+#endif
+#define ADC_SEQUENCE        (ZONES * ADC_SAMPLES)  // Uma amostra por ADC12MEMx
+#if ADC_SEQUENCE > 16
+#error "ZONES * ADC_SAMPLES passa de 16 posições do ADC12"
+#endif
+#define ADC_FILTER_MEDIAN   0   // Mediana das amostras
+#define ADC_FILTER_TRIMMED  1   // Média descartando ADC_TRIM em cada ponta
+#ifndef ADC_FILTER
+#define ADC_FILTER          ADC_FILTER_MEDIAN
+#endif
+#ifndef ADC_TRIM
+#define ADC_TRIM            2
+#endif
+
+// Vetor de interrupção da última posição da sequência (ADC12IFGx: 6 + 2x)
+#define ADC_LAST_IV         (6 + 2 * (ADC_SEQUENCE - 1))
+
+volatile bool adc_done = false;  // Fim de sequência sinalizado pela ISR
+
+/* * TEMPORIZAÇÃO DA ALIMENTAÇÃO DO SENSOR E DO ADC * */
+// O sensor (P6.1), o ADC e a referência só ficam ligados durante a leitura.
+#ifndef SENSOR_SETTLE_MS
+#define SENSOR_SETTLE_MS    50   // Sensor ligado, em LPM3, antes de converter
+#endif
+// A sonda é um divisor sobre a alimentação: com AVCC como fundo de escala a
+// leitura é proporcional e não muda com a bateria. Com ADC_USE_REF o fundo
+// de escala é a REF_A de 2,5 V: o código segue volts absolutos, acima de
+// 2,5 V satura, e a calibração (segmento B) precisa ser feita assim também.
+#ifndef ADC_USE_REF
+#define ADC_USE_REF         0    // 1 = referência interna (REF_A) na leitura
+#endif
+#define ADC_REF_SETTLE_US   75   // Estabilização da referência interna
+#define ADC_REF_MV          2500 // REFVSEL_2
+
+#if ADC_USE_REF
+#define ADC_SREF            ADC12SREF_1  // VREF+ / AVSS
+#else
+#define ADC_SREF            ADC12SREF_0  // AVCC / AVSS
+#endif
+
+/* * VIGÍLIA DO LIMIAR (COMPARATOR_B) * */
+// Com todas as zonas úmidas e sem rega, a leitura completa (ADC, histórico,
+// log, LCD) só acontece a cada SAMPLE_MAX_S. Nos intervalos adaptativos em
+// que ela aconteceria, um pulso de vigília liga a sonda e compara cada zona
+// com o seu limiar no Comparator_B: V+ é o pino da zona (CBx = Ax em P6) e
+// V- a escada de resistores sobre Vcc, na derivação logo abaixo do código
+// do limiar pela curva calibrada. Uma zona acima da derivação (mais seca)
+// gera a interrupção do comparador, e só então a leitura completa é
+// antecipada para confirmar e registrar. A escada tem passos de Vcc/32:
+// entre a derivação e o limiar todo pulso antecipa a leitura, como antes.
+#ifndef COMP_WATCH
+#define COMP_WATCH          1    // 0 = sempre a leitura completa
+#endif
+#define COMP_SETTLE_US      30   // Depois de trocar entrada ou derivação
+#define COMP_TAP_TOP        31   // Derivação n = Vcc x (n + 1) / 32
+
+uint8_t comp_tap[ZONES];          // Derivação (CBREF0/1) de cada zona
+uint16_t comp_interval_s = 0;     // Entre pulsos; 0 = vigília desligada
+volatile bool comp_crossed = false; // Alguma zona passou da derivação
+
+/* * ALIMENTAÇÃO (AVCC) E NÍVEIS DE ECONOMIA * */
+// A cada leitura, e de novo logo antes de partir uma bomba, uma conversão
+// avulsa mede (AVCC - AVSS) / 2 (ADC12INCH_11) contra a referência interna
+// de 2,0 V. O nível da alimentação escolhe quanto o controlador gasta: o
+// intervalo de amostragem é multiplicado, a telemetria fica mais rara, a
+// luz de fundo deixa de acender, a dose máxima da bomba encurta e, no
+// nível crítico, não há rega nem atualização do LCD. A partida da bomba é
+// o pico de corrente: com a bateria no fim, ela derrubaria o MSP430 e o
+// LCD. Subir de nível pede SUPPLY_HYST_MV acima do mínimo, para o nível
+// não oscilar com a queda de tensão sob carga.
+//
+// Abaixo de ~2,2 V a referência de 2,0 V sai de regulação e a medida fica
+// perto de 2,0 V: ainda no nível crítico.
+#define SUPPLY_NORMAL     0
+#define SUPPLY_SAVE       1
+#define SUPPLY_LOW        2
+#define SUPPLY_CRITICAL   3
+#define SUPPLY_TIERS      4
+
+#ifndef SUPPLY_NORMAL_MV
+#define SUPPLY_NORMAL_MV  2900   // Mínimo de cada nível
+#endif
+#ifndef SUPPLY_SAVE_MV
+#define SUPPLY_SAVE_MV    2700
+#endif
+#ifndef SUPPLY_LOW_MV
+#define SUPPLY_LOW_MV     2500
+#endif
+#define SUPPLY_HYST_MV    50
+#define SUPPLY_INTERVAL_MAX  4   // Maior multiplicador do intervalo
+
+#define ADC_SUPPLY_SLOT   15     // ADC12MCTL15 (ADC12CSTARTADD_15), emprestado na medida
+#define ADC_SUPPLY_IV     (6 + 2 * ADC_SUPPLY_SLOT)
+
+#if SAMPLE_MAX_S * SUPPLY_INTERVAL_MAX > 65535
+#error "SAMPLE_MAX_S x SUPPLY_INTERVAL_MAX não cabe no intervalo de 16 bits"
+#endif
+
+typedef struct
+{
+    uint16_t min_mv;       // AVCC mínimo
+    uint8_t interval_x;    // Multiplicador do intervalo de amostragem
+    uint8_t pump_max_ds;   // Dose máxima em regime; 0 = sem rega
+    uint8_t telem_every;   // Um quadro a cada n leituras; 0 = nenhum
+    bool backlight;        // Toque acende a luz de fundo
+    bool lcd;              // LCD atualizado; senão, só o aviso
+} supply_tier_t;
+
+const supply_tier_t supply_tiers[SUPPLY_TIERS] = {
+    { SUPPLY_NORMAL_MV, 1, PUMP_DOSE_MAX_DS,     1, true,  true  },
+    { SUPPLY_SAVE_MV,   2, PUMP_DOSE_MAX_DS / 2, 4, true,  true  },
+    { SUPPLY_LOW_MV,    SUPPLY_INTERVAL_MAX, PUMP_DOSE_MAX_DS / 4, 0, false, true  },
+    { 0,                SUPPLY_INTERVAL_MAX, 0,  0, false, false },
+};
+uint8_t supply_tier = SUPPLY_NORMAL;
+uint16_t supply_mv = 0;         // Última medida
+uint8_t telem_skipped = 0;      // Leituras desde o último quadro
+
 // Definições do LCD I2C
 #define LCD_ADDR 0x27
 #define RS_BIT   BIT0
@@ -32,6 +423,30 @@ unsigned int history_index = 0;         // Aponta para a posição atual do veto
 #define EN_BIT   BIT2
 #define BL_BIT   BIT3
 
+/* * LUZ DE FUNDO * */
+// A luz de fundo (P3 do PCF8574) é a maior corrente contínua do nó: fica
+// apagada, e as atualizações do LCD não a acendem. Um toque em S1 ou S2
+// acende por BL_ON_S. Com BL_DIM_ENABLE, P1.2 (TA0.1) comanda uma porta de
+// habilitação em série com o P3: depois de BL_ON_S a luz passa BL_DIM_S
+// esmaecida por um PWM no ACLK antes de apagar. Sem a porta, P1.2 fica como
+// entrada e a luz obedece só ao PCF8574.
+#ifndef BL_ON_S
+#define BL_ON_S        20   // Acesa após um toque
+#endif
+#ifndef BL_DIM_S
+#define BL_DIM_S       20   // Esmaecida em seguida (BL_DIM_ENABLE)
+#endif
+#define BL_DIM_PCT     25   // Brilho esmaecido
+#define BL_PWM_PERIOD  128  // Ciclos de ACLK: 256 Hz, sem cintilação visível
+#define BL_GATE_PIN    BIT2 // P1.2 = TA0.1
+
+#define BL_OFF  0
+#define BL_DIM  1
+#define BL_ON   2
+
+uint8_t lcd_backlight = BL_OFF;     // BL_BIT segue este estado em cada byte
+volatile bool bl_touched = false;   // Botão tocado desde a última Task_Backlight
+
 // Comandos LCD
 #define CMD_CLEAR_DISPLAY     0x01
 #define CMD_RETURN_HOME       0x02
@@ -39,24 +454,557 @@ unsigned int history_index = 0;         // Aponta para a posição atual do veto
 #define CMD_DISPLAY_CONTROL   0x0F
 #define CMD_FUNCTION_SET      0x28
 #define CMD_SECOND_LINE       0xC0
+#define CMD_SET_DDRAM         0x80  // OR com o endereço (linha 2 começa em 0x40)
 
-/* * VARIÁVEIS GLOBAIS 
- */
-volatile unsigned int dry_cycles = 0; // Contador de ciclos de seca
-volatile unsigned int pct_moisture = 0; // Contador de ciclos de seca
+/* * FILA DE TRANSMISSÃO I2C (USCI_B0 por interrupção) * */
+// Cada quadro na fila ocupa [endereço][tamanho][dados...].
+// O tamanho da fila deve ser potência de 2 (índices mascarados).
+#define I2C_QUEUE_SIZE 256
+#define I2C_QUEUE_MASK (I2C_QUEUE_SIZE - 1)
+
+volatile uint8_t i2c_queue[I2C_QUEUE_SIZE];
+volatile uint8_t i2c_head = 0;        // Próxima posição livre (escrita pelo main)
+volatile uint8_t i2c_tail = 0;        // Próximo byte a enviar (lido pela ISR)
+volatile uint8_t i2c_frame_left = 0;  // Bytes restantes do quadro em andamento
+volatile bool i2c_idle = true;        // Flag de conclusão: fila vazia e STOP emitido
+volatile bool i2c_waiting = false;    // main dormindo em LPM0 esperando espaço
+
+/* * RAJADA PARA O PCF8574 * */
+// O PCF8574 trava cada byte de dado de uma mesma escrita, então uma string
+// inteira (RS/EN/backlight já codificados) vai numa única transação I2C.
+// A tela toda reescrita por LCD_Update são até 140 bytes: 32 caracteres a
+// 4 bytes e 2 posicionamentos a 5, com o byte de preparação a cada troca
+// de RS. O quadro (mais endereço e tamanho) precisa caber na fila I2C.
+#define LCD_BURST_MAX 144
+#if LCD_BURST_MAX + 2 > I2C_QUEUE_SIZE - 1
+#error "LCD_BURST_MAX não cabe na fila I2C"
+#endif
+
+uint8_t lcd_burst[LCD_BURST_MAX];
+uint8_t lcd_burst_len = 0;
+uint8_t lcd_bus = 0xFF;  // Último valor escrito no PCF8574 (0xFF após o reset)
+
+/* * ESPELHO DO DISPLAY (2x16) * */
+// Cópia em RAM do que está no LCD: LCD_Update só envia as células que mudaram
+#define LCD_ROWS 2
+#define LCD_COLS 16
+#define LCD_MAX_GAP 2  // Células iguais reescritas em vez de mover o cursor
+
+char lcd_shadow[LCD_ROWS][LCD_COLS];
+uint8_t lcd_cursor = 0;  // Endereço DDRAM atual do cursor do LCD
+
+/* * PERFILAMENTO (opcional) * */
+// Defina PROFILE_ENABLE (ex.: --define=PROFILE_ENABLE) para medir quantos
+// ciclos de SMCLK cada etapa do main consome (carimbos de Cycles_Now()).
+// Desabilitado, os marcadores PROF_* não geram código algum.
+#ifdef PROFILE_ENABLE
+#define PROF_TRACE_SIZE 32  // Potência de 2
+
+// Seções medidas
+#define PROF_CONVERT   0
+#define PROF_SPRINTF   1
+#define PROF_LCD       2
+#define PROF_PUMP      3
+#define PROF_CALIB     4
+#define PROF_SECTIONS  5
+
+const char *const prof_names[PROF_SECTIONS] = { "convert", "sprintf", "lcd", "pump", "calib" };
+
+// Tabela fixa de estatísticas por seção (em ciclos de SMCLK)
+uint32_t prof_min[PROF_SECTIONS];
+uint32_t prof_max[PROF_SECTIONS];
+uint32_t prof_total[PROF_SECTIONS];
+uint16_t prof_count[PROF_SECTIONS];
+uint32_t prof_start[PROF_SECTIONS];
+
+// Buffer circular com os eventos mais recentes (bit 7 = fim de seção)
+uint8_t  prof_trace_id[PROF_TRACE_SIZE];
+uint32_t prof_trace_stamp[PROF_TRACE_SIZE];
+uint8_t  prof_trace_head = 0;
+
+#define PROF_INIT()    Prof_Init()
+#define PROF_BEGIN(s)  Prof_Begin(s)
+#define PROF_END(s)    Prof_End(s)
+#define PROF_DUMP()    Prof_Dump()
+#else
+#define PROF_INIT()
+#define PROF_BEGIN(s)
+#define PROF_END(s)
+#define PROF_DUMP()
+#endif
+
+/* * TELEMETRIA BINÁRIA (opcional) * */
+// Defina TELEMETRY_ENABLE para enviar um quadro binário pela UART de
+// backchannel a cada leitura. O DMA0 copia um byte para o UCA1TXBUF a cada
+// borda de UCTXIFG, então a CPU volta a LPM3 enquanto o quadro sai (~27 ms
+// a 9600 baud). host/telemetry.c decodifica o fluxo, que pode vir misturado
+// com as linhas de texto dos despejos.
+//
+// Quadro: TELEM_SYNC, tamanho do payload, payload (little-endian) e
+// CRC-16-CCITT (0x1021, início 0xFFFF) do tamanho e do payload.
+// Payload (versão 1):
+//   versão u8, seq u16, minuto u32 (relógio do log), umidade u8,
+//   mín u8, máx u8, média u8, tendência i16 (0,1 %/h),
+//   seco há u16 (min), próximo intervalo u16 (s), flags u8, bomba u32 (s)
+#ifdef TELEMETRY_ENABLE
+#define TELEM_SYNC     0xA5
+#define TELEM_VERSION  1
+#define TELEM_PAYLOAD  22
+#define TELEM_FRAME    (TELEM_PAYLOAD + 4)
+
+// Flags
+#define TELEM_DRY      0x01  // Contando a paciência
+#define TELEM_PUMPED   0x02  // Rega iniciada nesta leitura
+#define TELEM_BOOT     0x04  // Primeiro quadro depois de um reset
+
+uint8_t telem_frame[TELEM_FRAME];  // Lido pelo DMA até o fim do envio
+uint16_t telem_seq = 0;
+
+#define TELEM_SEND()  Telemetry_Send()
+#else
+#define TELEM_SEND()
+#endif
+
+/* * LOG TOKENIZADO * */
+// Diagnóstico barato o bastante para ficar ligado em produção. TRACE grava
+// num anel da RAM só o número da linha do chamador (o token) e os
+// argumentos crus, em palavras de 16 bits: nada de sprintf nem de textos
+// na flash. O formato fica só no fonte: host/trace gera dele o dicionário
+// (linha -> formato) e expande os registros de volta em texto, seja dos
+// quadros que saem pela UART, seja de um despejo da variável trace feito
+// pelo depurador. Um TRACE por linha, com o formato literal na mesma linha;
+// valores de 32 bits vão com TRACE_U32 e %lu/%ld/%lx.
+//
+// Registro: token u16, n u8, n argumentos u16 (little-endian). O anel é
+// despejado por DMA na Task_Service ao passar de TRACE_FLUSH_BYTES ou com
+// algo esperando há TRACE_FLUSH_S. Quadro: TRACE_SYNC, tamanho do payload,
+// payload, CRC-16-CCITT do tamanho e do payload (como a telemetria).
+// Payload: versão u8, dicionário u16, seq u16, minuto u32 (relógio do
+// log), registros perdidos com o anel cheio u16 e os registros.
+//
+// Os tokens só valem para o fonte que gerou o firmware. TRACE_DICT_ID é o
+// hash do dicionário, gerado junto com ele (trace -g, depois trace -h
+// trace.dict > trace_dict.h, incluído com -include no host ou
+// --preinclude no CCS); vai em cada quadro e no trace_t, e host/trace
+// recusa registros de outro dicionário. Sem o cabeçalho gerado fica 0,
+// que nenhum dicionário tem.
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE  1    // 0 = TRACE não gera código
+#endif
+
+#if TRACE_ENABLE
+#define TRACE_SYNC         0xA6
+#define TRACE_VERSION      2
+#define TRACE_RING_SIZE    128   // Potência de 2, até 128
+#define TRACE_MASK         (TRACE_RING_SIZE - 1)
+#define TRACE_HEADER       11
+#define TRACE_FRAME        (TRACE_RING_SIZE + TRACE_HEADER + 4)
+#define TRACE_FLUSH_BYTES  (TRACE_RING_SIZE / 2)
+#define TRACE_FLUSH_S      3600
+#define TRACE_RETRY_MS     50    // DMA ocupado com um quadro de telemetria
+
+#if TRACE_RING_SIZE > 128 || (TRACE_RING_SIZE & TRACE_MASK)
+#error "TRACE_RING_SIZE deve ser potência de 2 até 128"
+#endif
+
+#ifndef TRACE_DICT_ID
+#define TRACE_DICT_ID      0
+#endif
+
+// head e tail contam bytes sem máscara: ocupado = head - tail (mod 256)
+typedef struct
+{
+    uint16_t dict;        // TRACE_DICT_ID, para o despejo pelo depurador
+    uint8_t head;
+    uint8_t tail;
+    uint16_t dropped;     // Registros perdidos com o anel cheio
+    uint8_t ring[TRACE_RING_SIZE];
+} trace_t;
+
+trace_t trace = { TRACE_DICT_ID, 0, 0, 0, { 0 } };
+uint8_t trace_frame[TRACE_FRAME];   // Lido pelo DMA até o fim do envio
+uint16_t trace_seq = 0;
+uint32_t trace_flushed_s = 0;       // history_clock_s do último despejo
+
+#define TRACE0(fmt)      Trace_Put(__LINE__, 0, 0)
+#define TRACE(fmt, ...)  Trace_Put(__LINE__, (const uint16_t[]){ __VA_ARGS__ }, \
+                                   sizeof((const uint16_t[]){ __VA_ARGS__ }) / 2)
+#define TRACE_U32(x)     (uint16_t)(x), (uint16_t)((uint32_t)(x) >> 16)
+#else
+#define TRACE0(fmt)
+#define TRACE(fmt, ...)
+#endif
+
+// Telemetria e log dividem o DMA0 e a UART
+#if defined(TELEMETRY_ENABLE) || TRACE_ENABLE
+#define UART_DMA_ENABLE
+#endif
+
+/* * UART DE BACKCHANNEL * */
+// A USCI_A1 só é configurada (e UART_Write só existe) se alguém a usa: o
+// perfilamento, a telemetria, o log tokenizado ou os despejos de texto do
+// boot (DUMP_ENABLE: contadores de energia e arquivo de umidade).
+#ifndef DUMP_ENABLE
+#define DUMP_ENABLE  1
+#endif
+
+#if defined(PROFILE_ENABLE) || defined(UART_DMA_ENABLE) || DUMP_ENABLE
+#define UART_ENABLE
+#endif
+
+/* * PERFIS DE CLOCK (UCS + PMM) * */
+// MCLK = SMCLK = DCOCLKDIV, gerado pelo FLL a partir do cristal de 32768 Hz
+// do XT1 (ou do REFO, se o cristal não partir). Cada perfil fixa o
+// multiplicador do FLL, a faixa do DCO, o nível do Vcore que essa frequência
+// exige e o clock do ADC12 (até 5,4 MHz, com tsample de pelo menos 4 µs).
+#define CLOCK_LOW       0  // 1,05 MHz em PMMCOREV_0: o DCO padrão após o reset
+#define CLOCK_FAST      1  // 24,97 MHz em PMMCOREV_3
+#define CLOCK_PROFILES  2
+
+#ifndef CLOCK_RUN
+#define CLOCK_RUN  CLOCK_LOW  // Perfil adotado no boot
+#endif
+
+#define XT1_START_MS  1000       // Sem oscilar até aqui: fica no REFO
+#define I2C_BUS_HZ    100000UL   // SCL do barramento do LCD
+
+typedef struct
+{
+    uint16_t flln;     // DCOCLKDIV = 32768 x (FLLN + 1), com FLLD_1
+    uint16_t dcorsel;  // Faixa que contém o DCOCLK (2 x DCOCLKDIV)
+    uint16_t corev;    // Nível mínimo do Vcore
+    uint16_t adc_div;  // ADC12DIV_x
+    uint16_t adc_sht;  // ADC12SHT0_x | ADC12SHT1_x
+} clock_profile_t;
+
+const clock_profile_t clock_profiles[CLOCK_PROFILES] = {
+    {  31, DCORSEL_2, PMMCOREV_0, ADC12DIV_0, ADC12SHT0_0 | ADC12SHT1_0 },  // 4 ciclos
+    { 761, DCORSEL_7, PMMCOREV_3, ADC12DIV_4, ADC12SHT0_3 | ADC12SHT1_3 },  // 32 ciclos / 5
+};
+
+uint8_t clock_profile = CLOCK_LOW;
+uint32_t clock_smclk_hz = 1048576UL;  // Frequência atual do SMCLK (e do MCLK)
+uint16_t clock_smclk_per_ms = 1048;
+
+/* * EXECUÇÃO NA RAM * */
+// A flash do F5529 não tem estados de espera: até 25 MHz uma rotina gasta
+// os mesmos ciclos na flash e na RAM. O que muda é a corrente: executando
+// da RAM o modo ativo consome pouco mais da metade (IAM,RAM contra
+// IAM,Flash no datasheet). Vale para o que roda a cada byte ou a cada
+// despertar: as ISRs do RTC, do Timer_A2 e do I2C, o caminho do
+// escalonador ao acordar e a fila do I2C (enfileirar e abrir cada quadro,
+// montar os nibbles do LCD). LCD_Write_Nibble só roda na inicialização e
+// fica na flash.
+//
+// Com o compilador da TI, RAMFUNC põe a rotina na seção .TI.ramfunc. O
+// linker a grava na flash e o _c_int00 a copia para a RAM antes do main
+// pela tabela BINIT; o arquivo .cmd precisa da linha (já presente no
+// lnk_msp430f5529.cmd das versões recentes do CCS):
+//     .TI.ramfunc : {} load=FLASH, run=RAM, table(BINIT)
+// O tamanho de .TI.ramfunc no .map é a RAM consumida. Com RAMFUNC_REPORT,
+// acrescente RUN_SIZE(__ramfunc_size) à linha e o boot registra o tamanho
+// no log tokenizado. Outros compiladores deixam tudo na flash.
+#ifndef RAMFUNC_ENABLE
+#define RAMFUNC_ENABLE  1
+#endif
+
+#if !RAMFUNC_ENABLE
+#undef RAMFUNC
+#define RAMFUNC
+#elif defined(__TI_COMPILER_VERSION__)
+#define RAMFUNC __attribute__((ramfunc))
+#elif !defined(RAMFUNC)
+#define RAMFUNC
+#endif
+
+#if RAMFUNC_ENABLE && defined(__TI_COMPILER_VERSION__) && defined(RAMFUNC_REPORT)
+extern char __ramfunc_size[];   // Símbolo do linker: o endereço é o tamanho
+#endif
+
+/* * CONTADOR DE CICLOS ACORDADO * */
+// Timer_B0 conta SMCLK em modo contínuo. Como o SMCLK para em LPM3, o
+// contador só avança com a CPU ativa ou em LPM0.
+
+volatile uint16_t cycle_overflows = 0;  // Parte alta do contador de 32 bits
+
+/* * CONTABILIDADE DE ENERGIA * */
+// Contadores acumulados em RAM e gravados na memória de informação,
+// alternando entre os segmentos D e C: um reset no meio da gravação
+// preserva o registro anterior. Cada gravação apaga um segmento, então elas
+// só acontecem depois de ENERGY_CHECKPOINT_S segundos dormindo (no máximo 4
+// por dia com 6 h, cada segmento apagado 2 vezes por dia).
+#ifndef ENERGY_CHECKPOINT_S
+#define ENERGY_CHECKPOINT_S  21600UL
+#endif
+#define ENERGY_MAGIC  0xE4E7
+
+// Memória de informação: segmentos D, C, B e A de 128 bytes a partir de 0x1800
+#ifndef INFO_MEM
+#define INFO_MEM ((uint8_t *)0x1800)
+#endif
+#define INFO_SEGMENT_SIZE 128
+#define INFO_D (INFO_MEM + 0 * INFO_SEGMENT_SIZE)
+#define INFO_C (INFO_MEM + 1 * INFO_SEGMENT_SIZE)
+#define INFO_B (INFO_MEM + 2 * INFO_SEGMENT_SIZE)
+
+// Escrita fictícia que dispara o apagamento de um segmento (o modelo de
+// host a redefine para saber qual segmento apagar)
+#ifndef FLASH_DUMMY_WRITE
+#define FLASH_DUMMY_WRITE(p) (*(volatile uint16_t *)(p) = 0)
+#endif
+
+typedef struct
+{
+    uint16_t magic;
+    uint16_t seq;            // Registro mais recente = maior sequência
+    uint32_t boots;
+    uint32_t lpm3_s;         // Dormindo em LPM3
+    uint32_t active_ms;      // SMCLK ligado (CPU ativa ou LPM0)
+    uint32_t wakeups;        // Saídas de LPM
+    uint32_t pump_s;         // Bomba ligada
+    uint32_t lcd_refreshes;  // Chamadas a LCD_Update
+    uint32_t i2c_bytes;      // Bytes enfileirados para o barramento I2C
+    uint16_t checksum;
+} energy_t;
+
+#define ENERGY_WORDS      (sizeof(energy_t) / 2)
+#define ENERGY_SUM_WORDS  (offsetof(energy_t, checksum) / 2)
+
+energy_t energy;                  // Valores correntes
+uint8_t *energy_next_seg = INFO_D; // Segmento que recebe a próxima gravação
+uint16_t energy_lpm3_ms = 0;      // Fração de segundo ainda não somada a lpm3_s
+uint32_t energy_cycles_mark = 0;  // Cycles_Now() já convertido em active_ms
+uint32_t energy_saved_lpm3_s = 0; // lpm3_s na última gravação
+uint16_t energy_pump_ms = 0;      // Fração de segundo ainda não somada a pump_s
+
+/* * CALIBRAÇÃO DAS SONDAS * */
+// O ADC lê 12 bits e cada zona converte o código em umidade por uma curva
+// linear por partes de CAL_POINTS pontos, com códigos crescentes. A curva
+// fica no segmento B da memória de informação, gravado junto com o firmware
+// (ou por uma ferramenta de bancada). Sem registro válido vale a reta entre
+// CAL_WET_CODE (100 %) e CAL_DRY_CODE (0 %): a calibração de dois pontos.
+// Com os valores padrão é o mapa linear antigo, agora em 12 bits.
+//
+// Cal_Prepare transforma cada trecho em base + inclinação (Q16) uma vez no
+// boot. Cada leitura custa uma multiplicação-acumulação no MPY32, sem
+// nenhuma divisão.
+#define CAL_POINTS  5    // Pontos por zona (o formato do registro é fixo)
+#define CAL_SLOTS   4    // Zonas no registro: o máximo de ZONES
+#define CAL_MAGIC   0xCA1B
+#define ADC_FULL_SCALE 4095
+#ifndef CAL_WET_CODE
+#define CAL_WET_CODE   0               // Sonda na água
+#endif
+#ifndef CAL_DRY_CODE
+#define CAL_DRY_CODE   ADC_FULL_SCALE  // Sonda no ar
+#endif
+#if CAL_WET_CODE > ADC_FULL_SCALE || CAL_DRY_CODE > ADC_FULL_SCALE || \
+    CAL_WET_CODE - CAL_DRY_CODE < CAL_POINTS && CAL_DRY_CODE - CAL_WET_CODE < CAL_POINTS
+#error "CAL_WET_CODE e CAL_DRY_CODE precisam estar na escala e afastados"
+#endif
+
+typedef struct
+{
+    uint16_t code;  // Leitura do ADC (12 bits)
+    uint16_t pct;   // Umidade correspondente (0 a 100)
+} cal_point_t;
+
+typedef struct
+{
+    uint16_t magic;
+    cal_point_t point[CAL_SLOTS][CAL_POINTS];
+    uint16_t checksum;
+} cal_t;
+
+#define CAL_SUM_WORDS  (offsetof(cal_t, checksum) / 2)
+
+cal_t cal;                                  // Curva em uso
+uint16_t cal_code[ZONES][CAL_POINTS];       // Início de cada trecho (e fim do último)
+int16_t  cal_slope[ZONES][CAL_POINTS - 1];  // Pontos percentuais por código, Q16
+uint32_t cal_base[ZONES][CAL_POINTS - 1];   // Umidade no início, Q16 + 0,5
+
+/* * LOG PERSISTENTE NA FLASH PRINCIPAL * */
+// Cada leitura vira um registro de 8 bytes gravado em sequência num anel de
+// LOG_SEGMENTS segmentos de 512 bytes. Um segmento só é apagado quando a
+// gravação chega nele, uma vez por volta do anel: com 32 segmentos são 2048
+// registros (~85 dias de leituras horárias) entre dois apagamentos do mesmo
+// segmento. A posição no anel é seq % LOG_CAPACITY, então LOG_CAPACITY
+// precisa ser potência de 2 para a sequência de 16 bits dar a volta junto.
+#define FLASH_SEGMENT_SIZE 512
+#ifndef LOG_SEGMENTS
+#define LOG_SEGMENTS  32
+#endif
+#define LOG_BOOT_FLAG 0x80  // Primeira leitura depois de um reset
+
+typedef struct
+{
+    uint16_t seq;
+    uint16_t minute_lo;      // Minutos do relógio do log (24 bits)
+    uint8_t  minute_hi;
+    uint8_t  value;          // Umidade (%) | LOG_BOOT_FLAG
+    uint16_t checksum;       // ~soma das 3 primeiras palavras
+} log_record_t;
+
+#define LOG_RECORD_WORDS  (sizeof(log_record_t) / 2)
+#define LOG_PER_SEGMENT   (FLASH_SEGMENT_SIZE / sizeof(log_record_t))
+#define LOG_CAPACITY      (LOG_SEGMENTS * LOG_PER_SEGMENT)
+
+// Registros relidos no boot: os HISTORY_SIZE últimos refazem a janela e o
+// resto, até cobrir ARCH_HOURS horas amostrando no intervalo mínimo, só o
+// arquivo. O boot custa o mesmo com o log cheio ou quase vazio.
+#ifndef LOG_REPLAY_MAX
+#define LOG_REPLAY_MAX    (ARCH_HOURS * 3600UL / SAMPLE_MIN_S)
+#endif
+#if LOG_REPLAY_MAX < HISTORY_SIZE
+#error "LOG_REPLAY_MAX precisa cobrir a janela"
+#endif
+
+// O vetor const é reservado pelo linker na flash principal; gravar o
+// firmware o zera (registros inválidos). O firmware só o lê por ponteiro
+// volátil. O modelo de host redefine FLASH_CONST para poder gravá-lo.
+#ifndef FLASH_CONST
+#define FLASH_CONST const
+#endif
+#pragma DATA_ALIGN(log_flash, 512)
+FLASH_CONST uint8_t log_flash[LOG_SEGMENTS * FLASH_SEGMENT_SIZE] = { 0 };
+#define LOG_RECORD(pos) ((const volatile log_record_t *)log_flash + (pos))
+
+uint16_t log_seq = 0;          // Sequência do próximo registro
+uint32_t log_minute_base = 0;  // Relógio do log no boot (minutos)
+bool log_booted = false;       // Já gravou desde o reset
 
 /* * PROTÓTIPOS 
  */
 void Init_Peripherals(void);
 void LCD_Init_I2C_RegisterLevel(void);
+void I2C_Set_Rate(void);
 void LCD_Init(void);
 void LCD_Write_Nibble(uint8_t nibble, uint8_t isChar);
 void LCD_Write_Byte(uint8_t byte, uint8_t isChar);
 void LCD_Update(char *str);
+void LCD_Burst_Nibble(uint8_t nibble, uint8_t isChar);
+void LCD_Burst_Byte(uint8_t byte, uint8_t isChar);
+void LCD_Burst_Flush(void);
+void LCD_Backlight(uint8_t state);
 void I2C_Send(uint8_t addr, uint8_t data);
+void I2C_Queue_Frame(uint8_t addr, const uint8_t *data, uint8_t len);
+uint8_t I2C_Queue_Free(void);
+void I2C_Start_Frame(void);
+void I2C_Kick(void);
+void I2C_Wait_Idle(void);
 void Delay_us_Custom(unsigned int time_us);
-void Enter_Assistive_Wait(uint16_t seconds);
-uint16_t convert();
+void convert(uint16_t *results);
+uint16_t ADC_Reduce(uint16_t *samples);
+void Read_Sensor(uint16_t *results);
+void ADC_Power_On(void);
+void ADC_Power_Off(void);
+void ADC_Run(void);
+uint16_t Supply_Read_mV(void);
+void Supply_Check(void);
+uint16_t Supply_Interval(uint16_t interval_s);
+void Enter_Assistive_Wait_ms(uint16_t ms);
+void Vtimer_Init(void);
+uint32_t Vtimer_Now(void);
+void Vtimer_After(uint8_t id, uint32_t ticks);
+void Vtimer_Cancel(uint8_t id);
+void Vtimer_Unlink(uint8_t id);
+void Vtimer_Arm(void);
+void Vtimer_Wait(uint8_t id, uint32_t ticks);
+#ifdef UART_ENABLE
+void UART_Init(void);
+void UART_Write(const char *str);
+#endif
+#ifdef UART_DMA_ENABLE
+void UART_Wait_Idle(void);
+void UART_Send_DMA(const uint8_t *data, uint8_t len);
+uint16_t CRC16_Update(uint16_t crc, uint8_t byte);
+uint8_t *Put_LE(uint8_t *p, uint32_t value, uint8_t bytes);
+#endif
+#ifdef TELEMETRY_ENABLE
+void Telemetry_Send(void);
+#endif
+#if TRACE_ENABLE
+void Trace_Put(uint16_t token, const uint16_t *args, uint8_t n);
+void Trace_Service(void);
+void Trace_Flush(void);
+#endif
+void Clock_Init(void);
+void Clock_Set(uint8_t profile);
+void PMM_Step_Up(void);
+void PMM_Step_Down(void);
+void Cycles_Init(void);
+uint32_t Cycles_Now(void);
+void Energy_Load(void);
+void Energy_Save(void);
+void Energy_Service(void);
+void Energy_Update_Active(void);
+void Energy_Add_LPM3_ms(uint16_t ms);
+void Energy_Add_Pump_ms(uint16_t ms);
+uint16_t Energy_Checksum(const energy_t *e);
+#if DUMP_ENABLE
+void Energy_Dump(void);
+#endif
+void Energy_Show(void);
+void Flash_Erase_Segment(uint8_t *segment);
+void Flash_Write_Words(uint8_t *dst, const uint16_t *data, uint8_t words);
+uint16_t Cal_Checksum(const cal_t *c);
+bool Cal_Valid(const cal_t *c);
+void Cal_Two_Point(uint8_t z, uint16_t wet, uint16_t dry);
+void Cal_Load(void);
+void Cal_Prepare(void);
+uint8_t Cal_Percent(uint8_t z, uint16_t code);
+uint16_t Cal_Code(uint8_t z, uint8_t pct);
+bool Comp_Watch_Start(uint16_t interval_s);
+uint16_t Log_Checksum(const volatile log_record_t *r);
+bool Log_In_Lap(uint16_t pos, uint16_t base);
+bool Log_Blank(uint16_t pos);
+void Log_Recover(void);
+void Log_Append(uint8_t value);
+void History_Insert(uint8_t value, uint16_t dt_s);
+uint8_t Stats_Min(void);
+uint8_t Stats_Max(void);
+uint8_t Stats_Mean(void);
+int16_t Stats_Trend(void);
+void Archive_Insert(uint8_t value);
+void Archive_Close(void);
+#if DUMP_ENABLE
+void Archive_Dump(void);
+#endif
+void Arch_Fold(arch_acc_t *a, uint8_t mean, uint8_t min, uint8_t max);
+void Arch_Push(arch_ring_t *r, uint8_t mean, uint8_t min, uint8_t max);
+void Arch_Drop(arch_ring_t *r);
+void Arch_Decode(const arch_ring_t *r, uint16_t *pos, uint8_t i,
+                 uint8_t *mean, uint8_t *min, uint8_t *max);
+void Arch_Put(arch_ring_t *r, uint8_t value);
+uint8_t Arch_Field(const arch_ring_t *r, uint16_t *pos);
+void Show_Moisture(const char *label);
+uint16_t Next_Interval(uint8_t z);
+uint16_t Pump_Dose(uint8_t z);
+void Pump_Track(uint8_t z);
+uint16_t Pump_Current(uint8_t z);
+void Sched_Init(void);
+uint32_t Sched_Now(void);
+bool Sched_Arm(uint32_t deadline);
+void Sched_At(uint8_t task, uint32_t deadline);
+void Sched_After(uint8_t task, uint32_t ticks);
+void Sched_Cancel(uint8_t task);
+void Sched_Post(uint8_t task);
+void Sched_Expire(void);
+void Sched_Idle(void);
+void Sched_Run(void);
+void Task_Sense(void);
+void Task_Display(void);
+void Task_Pump(uint8_t z);
+void Task_Telemetry(void);
+void Task_Service(void);
+void Task_Backlight(void);
+void Task_Watch(void);
+#ifdef PROFILE_ENABLE
+void Prof_Init(void);
+void Prof_Begin(uint8_t section);
+void Prof_End(uint8_t section);
+void Prof_Dump(void);
+#endif
 
 /*
  * FUNÇÃO MAIN
@@ -68,88 +1016,323 @@ void main(void){
     // 1. Inicializa Periféricos
     Init_Peripherals();
 
-    // Habilita interrupções globais (Necessário para o Timer acordar a CPU do LPM3)
+    // Habilita interrupções globais (Necessário para o RTC acordar a CPU do LPM3)
     __enable_interrupt();
+
+    // Cristal no ACLK e no FLL, depois o perfil de clock de trabalho
+    Clock_Init();
+    Clock_Set(CLOCK_RUN);
     
+    // Recupera os contadores de energia gravados antes do reset
+    Energy_Load();
+#if DUMP_ENABLE
+    Energy_Dump();
+#endif
+    TRACE("boot %lu", TRACE_U32(energy.boots));
+#if RAMFUNC_ENABLE && defined(__TI_COMPILER_VERSION__) && defined(RAMFUNC_REPORT)
+    TRACE("ramfunc: %u bytes de RAM", (uint16_t)(uintptr_t)__ramfunc_size);
+#endif
+
+    // Curva de calibração das sondas (segmento B)
+    Cal_Load();
+
+    // Acha o fim do log e refaz a janela de estatísticas e o arquivo com ele
+    Log_Recover();
+#if DUMP_ENABLE
+    Archive_Dump();
+#endif
+
     // 2. Inicializa LCD e exibe mensagem inicial
     LCD_Init();
     LCD_Update("Iniciando...");
     
-    // Espera 2s para estabilização inicial do sistema
-    Enter_Assistive_Wait(2); 
+    // 3. Agenda as primeiras tarefas: 2s de estabilização, os contadores
+    // acumulados por 2s e então a primeira leitura. Daqui em diante tudo
+    // roda pelo escalonador.
+    Sched_Init();
+    Sched_After(TASK_DISPLAY, 2 * SCHED_TICKS_PER_S);
+    Sched_After(TASK_SENSE, 4 * SCHED_TICKS_PER_S);
+    Sched_Run();
+}
 
-    while(1)
-    {
-        // --- ETAPA 1: LEITURA DO SENSOR (ADC) ---
+/*
+ * TAREFAS DO CONTROLADOR
+ */
+
+// Leitura, decisão e agenda da próxima leitura. A leitura seguinte é
+// marcada a partir do prazo desta, não do fim dela: o intervalo entre
+// leituras é exato e serve de relógio para o histórico e a paciência.
+void Task_Sense(void)
+{
+    uint16_t adc_result[ZONES];
+    uint8_t z;
+    bool dry = false, pumping = false;
+
+    // --- ETAPA 1: LEITURA DOS SENSORES (ADC) ---
 
-        // Inicia conversão (Trigger por software) e guarda o valor do ADC (0 a 255)
-        uint16_t adc_result = convert();
+    // Inicia conversão (Trigger por software) e guarda o valor do ADC (0 a 4095)
+    // Liga sensores e ADC só durante a leitura; todas as zonas numa sequência
+    PROF_BEGIN(PROF_CONVERT);
+    Read_Sensor(adc_result);
+    PROF_END(PROF_CONVERT);
 
-        // --- ETAPA 2: LÓGICA DE DECISÃO E CONTROLE ---
-        // valor de voltagem para int
-        pct_moisture = 100-(adc_result*100)/255;
-        
-        // leitura histórica do moisture
-        moisture_history[history_index] = (uint8_t)pct_moisture;
-        if (history_index >= HISTORY_SIZE) history_index = 0;
-        else history_index++;
+    // AVCC a cada leitura: o nível decide o resto do ciclo
+    Supply_Check();
 
-        if(pct_moisture < 30) 
+    // --- ETAPA 2: LÓGICA DE DECISÃO E CONTROLE ---
+    for (z = 0; z < ZONES; z++)
+    {
+        zone_t *zone = &zones[z];
+
+        // Código do ADC para umidade pela curva calibrada da zona
+        PROF_BEGIN(PROF_CALIB);
+        zone->pct = Cal_Percent(z, adc_result[z]);
+        PROF_END(PROF_CALIB);
+        Pump_Track(z);
+
+        if(zone->pct < zone_cfg[z].threshold) 
         {
             // SOLO SECO
-            if (dry_cycles < 4) 
+            // A paciência conta tempo, não leituras: o intervalo agora varia
+            if (!zone->dry_streak)
             {
-                // Modo Paciência: Espera até 4 ciclos
-                dry_cycles++;
-                char buffer[32]; // Create a temporary character array
-
-                // Format the text into the buffer
-                sprintf(buffer, "      Solo Seco\n      %d", pct_moisture);
+                zone->dry_streak = true;
+                zone->dry_seconds = 0;
+            }
+            else zone->dry_seconds += sample_interval_s;
 
-                // Send the buffer to the LCD
-                LCD_Update(buffer);            
-                }
-            else 
+            if (zone->dry_seconds < DRY_PATIENCE_S) 
+            {
+                // Modo Paciência: Espera até 4 horas
+                dry = true;
+            }
+            else if (zone->pump_state == PUMP_IDLE && supply_tiers[supply_tier].pump_max_ds)
             {
-                // Ação: Irrigar
-                LCD_Update("   Irrigando..."); 
-                
-                // 1. Liga a bomba
-                P2OUT |= PUMP_PIN;
-                P1OUT |= PLED_PIN; // Liga o led para mostrar que a bomba está ligada
-                
-                // 2. Mantém ligada por 5 segundos
-                Enter_Assistive_Wait(5);
-                
-                // 3. Desliga a bomba
-                P2OUT &= ~PUMP_PIN;
-                P1OUT &= ~PLED_PIN; // Desliga o led para mostrar que a bomba está desligada
-                
-                // Format the text into the buffer
-                char buffer[32]; // Create a temporary character array
-                sprintf(buffer, "      Solo Umido\n      %d", pct_moisture);
-
-                // Send the buffer to the LCD
-                LCD_Update(buffer);   
+                // Ação: Irrigar. A tarefa da zona aplica a dose da lei PI
+                // assim que houver folga de corrente.
+                zone->pump_dose_ds = Pump_Dose(z);
+                zone->pump_state = PUMP_WAIT;
+                Sched_Post(TASK_PUMP + z);
             }
         }
         else 
         {
-            // SOLO ÚMIDO - Reinicia ciclos
-            dry_cycles = 0;
-            // Format the text into the buffer
-            char buffer[32]; // Create a temporary character array
-            sprintf(buffer, "      Solo Umido\n      %d", pct_moisture);
-
-            // Send the buffer to the LCD
-            LCD_Update(buffer); 
+            // SOLO ÚMIDO - Reinicia a paciência
+            zone->dry_streak = false;
+        }
+        if (zone->pump_state != PUMP_IDLE) pumping = true;
+    }
+
+    // leitura histórica da zona 0 (atualiza min/máx/média/tendência)
+    History_Insert(zones[0].pct, sample_interval_s);
+    Log_Append(zones[0].pct);
+
+    // A tela volta para "Solo Umido" quando a última bomba desliga
+    display_mode = pumping ? DISPLAY_PUMPING : DISPLAY_MOISTURE;
+    display_label = dry ? "      Solo Seco" : "      Solo Umido";
+
+    // --- ETAPA 3: PRÓXIMA LEITURA ---
+    // Intervalo adaptativo entre SAMPLE_MIN_S e SAMPLE_MAX_S, o da zona mais
+    // urgente; até lá a CPU só acorda para as bombas, o LCD ou a telemetria.
+    sample_interval_s = SAMPLE_MAX_S;
+    for (z = 0; z < ZONES; z++)
+    {
+        uint16_t interval = Next_Interval(z);
+        if (interval < sample_interval_s) sample_interval_s = interval;
+    }
+#if COMP_WATCH
+    // Vigília armada: os pulsos do comparador ficam com o intervalo
+    // adaptativo e a próxima leitura completa vai para SAMPLE_MAX_S
+    if (Comp_Watch_Start(Supply_Interval(sample_interval_s))) sample_interval_s = SAMPLE_MAX_S;
+#endif
+    // Bateria baixa: tudo mais espaçado
+    sample_interval_s = Supply_Interval(sample_interval_s);
+    Sched_At(TASK_SENSE, sched_deadline[TASK_SENSE] +
+                         ((uint32_t)sample_interval_s << 15));
+
+    Sched_Post(TASK_DISPLAY);
+    Sched_Post(TASK_TELEMETRY);
+    Sched_Post(TASK_SERVICE);
+}
+
+void Task_Display(void)
+{
+    // Nível crítico: só o aviso, que o espelho não reescreve
+    if (!supply_tiers[supply_tier].lcd)
+    {
+        LCD_Update("  Bateria fraca");
+        return;
+    }
+
+    switch (display_mode)
+    {
+    case DISPLAY_ENERGY:
+        Energy_Show();
+        break;
+    case DISPLAY_PUMPING:
+        PROF_BEGIN(PROF_LCD);
+        LCD_Update("   Irrigando...");
+        PROF_END(PROF_LCD);
+        break;
+    default:
+        Show_Moisture(display_label);
+        break;
+    }
+}
+
+// Rega da zona z: espera folga de corrente, liga a bomba (na zona com PWM,
+// PUMP_RAMP_STEPS degraus a cada PUMP_RAMP_MS) e aplica a dose em regime.
+// Entre os passos a CPU dorme em LPM3 com o PWM rodando no ACLK, livre para
+// as outras tarefas.
+void Task_Pump(uint8_t z)
+{
+    zone_t *zone = &zones[z];
+    const zone_cfg_t *cfg = &zone_cfg[z];
+    uint8_t i;
+
+    if (zone->pump_state == PUMP_WAIT)
+    {
+        // Uma bomba sozinha sempre pode partir, mesmo acima do limite
+        if (pump_current_ma && pump_current_ma + Pump_Current(z) > PUMP_CURRENT_LIMIT_MA)
+            return;  // Postada de novo quando alguma bomba desligar
+
+        // A partida é o pico de corrente: confere a alimentação antes. Sem
+        // rega no nível crítico (o LCD só mostra o aviso); nos outros, a
+        // dose encurta até o máximo do nível.
+        Supply_Check();
+        if (!supply_tiers[supply_tier].pump_max_ds)
+        {
+            TRACE("zona %u: rega cancelada, %u mV", z, supply_mv);
+            zone->pump_state = PUMP_IDLE;
+            return;
+        }
+        if (zone->pump_dose_ds > supply_tiers[supply_tier].pump_max_ds)
+            zone->pump_dose_ds = supply_tiers[supply_tier].pump_max_ds;
+
+        if (!pump_current_ma)
+        {
+            PROF_BEGIN(PROF_PUMP);
+        }
+        pump_current_ma += Pump_Current(z);
+        P1OUT |= PLED_PIN; // Liga o led para mostrar que há bomba ligada
+        TRACE("zona %u: bomba liga, dose %u ds, %u mV", z, zone->pump_dose_ds, supply_mv);
+
+        if (cfg->pwm)
+        {
+            TA1CCR0 = PUMP_PERIOD;
+            TA1CCR1 = 0;
+            TA1CCTL1 = OUTMOD_7;
+            TA1CTL = TASSEL__ACLK | MC__UP | TACLR;
+
+            zone->pump_step = 0;
+            zone->pump_state = PUMP_RAMP;
+        }
+        else
+        {
+            P2OUT |= cfg->pump_pin;
+            zone->pump_state = PUMP_HOLD;
+            Sched_After(TASK_PUMP + z, SCHED_MS((uint32_t)zone->pump_dose_ds * 100));
+            return;
+        }
+    }
+
+    if (zone->pump_state == PUMP_RAMP)
+    {
+        // Partida suave: a corrente de partida do motor sobe aos poucos e não
+        // derruba a alimentação do MSP430 e do LCD
+        if (zone->pump_step < PUMP_RAMP_STEPS)
+        {
+            zone->pump_step++;
+            TA1CCR1 = (uint16_t)((uint32_t)(PUMP_PERIOD + 1) * PUMP_DUTY_PCT * zone->pump_step /
+                                 (100 * PUMP_RAMP_STEPS));
+            Sched_After(TASK_PUMP + z, SCHED_MS(PUMP_RAMP_MS));
+            return;
         }
 
-        // --- ETAPA 3: HIBERNAÇÃO ---
-        // Espera 1 hora (3600 segundos)
-        // O processador desliga completamente por 1 hora.
-        Enter_Assistive_Wait(3600); 
+        zone->pump_state = PUMP_HOLD;
+        Sched_After(TASK_PUMP + z, SCHED_MS((uint32_t)zone->pump_dose_ds * 100));
+        return;
+    }
+
+    if (zone->pump_state != PUMP_HOLD) return;
+
+    // Fim da dose. OUTMOD_0 desliga o pino de vez (CCR1 = 0 em OUTMOD_7
+    // ainda deixaria um pulso de uma contagem por período)
+    if (cfg->pwm)
+    {
+        TA1CCTL1 = OUTMOD_0;
+        TA1CTL = MC_0;
+        Energy_Add_Pump_ms(PUMP_RAMP_STEPS * PUMP_RAMP_MS + zone->pump_dose_ds * 100);
+    }
+    else
+    {
+        P2OUT &= ~cfg->pump_pin;
+        Energy_Add_Pump_ms(zone->pump_dose_ds * 100);
+    }
+    zone->pump_state = PUMP_IDLE;
+    pump_current_ma -= Pump_Current(z);
+    TRACE("zona %u: bomba desliga", z);
+
+    // Folga de corrente: as zonas em espera tentam partir
+    for (i = 0; i < ZONES; i++)
+        if (zones[i].pump_state == PUMP_WAIT) Sched_Post(TASK_PUMP + i);
+
+    if (pump_current_ma) return;
+
+    P1OUT &= ~PLED_PIN; // Desliga o led: nenhuma bomba ligada
+    PROF_END(PROF_PUMP);
+
+    for (i = 0; i < ZONES; i++)
+        if (zones[i].pump_state != PUMP_IDLE) return;
+
+    display_mode = DISPLAY_MOISTURE;
+    display_label = "      Solo Umido";
+    Sched_Post(TASK_DISPLAY);
+}
+
+// Quadro de telemetria por DMA; termina de sair durante o LPM3. Com a
+// bateria baixa, só a cada telem_every leituras.
+void Task_Telemetry(void)
+{
+    uint8_t every = supply_tiers[supply_tier].telem_every;
+
+    if (!every || ++telem_skipped < every) return;
+    telem_skipped = 0;
+    TELEM_SEND();
+}
+
+void Task_Service(void)
+{
+    // Envia a tabela e o trace pela UART de backchannel (só com PROFILE_ENABLE)
+    PROF_DUMP();
+
+    // Converte o tempo acordado e grava os contadores se já é hora
+    Energy_Service();
+
+#if TRACE_ENABLE
+    Trace_Service();
+#endif
+}
+
+// Toque num botão: acende e reinicia o prazo (repiques só o reiniciam de
+// novo). Prazo vencido: esmaece, se houver a porta de PWM, e depois apaga.
+void Task_Backlight(void)
+{
+    if (bl_touched && !supply_tiers[supply_tier].backlight) bl_touched = false;
+    else if (bl_touched)
+    {
+        bl_touched = false;
+        LCD_Backlight(BL_ON);
+        Sched_After(TASK_BACKLIGHT, BL_ON_S * SCHED_TICKS_PER_S);
+    }
+#ifdef BL_DIM_ENABLE
+    else if (lcd_backlight == BL_ON)
+    {
+        LCD_Backlight(BL_DIM);
+        Sched_After(TASK_BACKLIGHT, BL_DIM_S * SCHED_TICKS_PER_S);
     }
+#endif
+    else LCD_Backlight(BL_OFF);
 }
 
 /*
@@ -163,198 +1346,2401 @@ void Init_Peripherals(void)
     P6DIR |= SENSOR_PWR_PIN;
     P6OUT &= ~SENSOR_PWR_PIN;
 
-    // --- Configuração da Bomba (GPIO) ---
-    P2DIR |= PUMP_PIN;
-    P2OUT &= ~PUMP_PIN;
+    // --- Configuração das Bombas e dos Sensores das zonas ---
+    // Bomba com PWM: TA1.1 em OUTMOD_0 com OUT = 0, pino em baixo enquanto
+    // o Timer_A1 está parado. As demais são GPIO em baixo.
+    TA1CCTL1 = OUTMOD_0;
+    uint8_t i;
+    for (i = 0; i < ZONES; i++)
+    {
+        P2DIR |= zone_cfg[i].pump_pin;
+        P2OUT &= ~zone_cfg[i].pump_pin;
+        if (zone_cfg[i].pwm) P2SEL |= zone_cfg[i].pump_pin;
+
+        // Pino P6.x como entrada analógica Ax do ADC e CBx do comparador
+        P6SEL |= 1 << zone_cfg[i].inch;
+        CBCTL3 |= 1 << zone_cfg[i].inch;
+    }
     P1DIR |= PLED_PIN; // LED
     P1OUT &= ~PLED_PIN; // LED
 
-    // Configuro o P6.0 para o pino A0 do ADC.
-    P6SEL |= SENSOR_PIN;
+    // Botões: entrada com pull-up, interrupção na descida (toque)
+    P1DIR &= ~BTN_S2_PIN;
+    P1REN |= BTN_S2_PIN;
+    P1OUT |= BTN_S2_PIN;
+    P1IES |= BTN_S2_PIN;
+    P1IFG &= ~BTN_S2_PIN;
+    P1IE |= BTN_S2_PIN;
+    P2DIR &= ~BTN_S1_PIN;
+    P2REN |= BTN_S1_PIN;
+    P2OUT |= BTN_S1_PIN;
+    P2IES |= BTN_S1_PIN;
+    P2IFG &= ~BTN_S1_PIN;
+    P2IE |= BTN_S1_PIN;
+
+#ifdef BL_DIM_ENABLE
+    // Porta da luz de fundo habilitada; quem acende é o bit do PCF8574
+    P1DIR |= BL_GATE_PIN;
+    P1OUT |= BL_GATE_PIN;
+#endif
 
     // Desliga o módulo para permitir alterações
     ADC12CTL0 &= ~ADC12ENC;
 
+    // O ADC fica desligado entre leituras (ver ADC_Power_On/Off)
     ADC12CTL0 = ADC12SHT0_0 |      // 4 ciclos para o tsample
-                ADC12ON;           // Liga o ADC
+                ADC12MSC;          // Um disparo converte a sequência inteira
 
     ADC12CTL1 = ADC12CSTARTADD_0 | // Start address: 0
                 ADC12SHS_0 |       // Conversão disparado manualmente
                 ADC12SHP |         // Sample and Hold Pulse mode: input
                 ADC12DIV_0 |       // Divide o clock por 1
                 ADC12SSEL_3 |      // Escolhe o clock SMCLK
-                ADC12CONSEQ_0;     // Modo: single channel
+                ADC12CONSEQ_1;     // Modo: sequência de canais, uma passada
 
-    // ALTERAÇÃO AQUI: Resolução de 8 bits (ADC12RES_0)
+    // Resolução de 12 bits: a curva de calibração (Cal_Percent) usa o código inteiro
     ADC12CTL2 = ADC12TCOFF |       // Desliga sensor temp
-                ADC12RES_0;        // 8 bits resolution
+                ADC12RES_2;        // 12 bits resolution
 
-    // Configurações dos canais
-    ADC12MCTL0 = ADC12SREF_0 |     // Vcc/Vss
-                 ADC12INCH_0;      // Amostra o pino A0
+    // Configurações dos canais: ADC_SAMPLES posições seguidas por zona, cada
+    // grupo amostrando o pino da sua zona. Os ADC12MCTLx são consecutivos na
+    // memória, assim como os ADC12MEMx.
+    for (i = 0; i < ADC_SEQUENCE; i++)
+    {
+        (&ADC12MCTL0)[i] = ADC_SREF |                        // Ver ADC_USE_REF
+                           zone_cfg[i / ADC_SAMPLES].inch;   // ADC12INCH_x
+    }
+    (&ADC12MCTL0)[ADC_SEQUENCE - 1] |= ADC12EOS;  // Fim da sequência
+
+    // Só a última posição gera interrupção: fim da rajada
+    ADC12IE = 1U << (ADC_SEQUENCE - 1);
+
+    // A conversão é habilitada em ADC_Power_On()
 
-    // Habilita conversão
-    ADC12CTL0 |= ADC12ENC; 
+    // --- Comparator_B (vigília do limiar) ---
+    // Desligado entre pulsos. Escada sobre Vcc no V-, filtro de saída contra
+    // repiques; Task_Watch escolhe a entrada e a derivação.
+    CBCTL1 = CBPWRMD_1 | CBF | CBFDLY_3;
+    CBCTL2 = CBRSEL | CBRS_1;
+    CBINT = 0;
 
     // --- Configuração do I2C ---
     LCD_Init_I2C_RegisterLevel();
-}
 
-/*
- * FUNÇÃO DE CONVERSÃO DO ADC
- */
-uint16_t convert()
-{
-    //Faço o rising edge no ADC12SC (conversão manual)
-    ADC12CTL0 &= ~ADC12SC;
-    ADC12CTL0 |= ADC12SC;
+#ifdef UART_ENABLE
+    // --- Configuração da UART de backchannel ---
+    UART_Init();
+#endif
 
-    //Aguardo o ADC terminar a conversão 13 ciclos
-    __delay_cycles(13);
+    // --- Contador de ciclos acordado (energia e perfilamento) ---
+    // Sem pedidos condicionais de clock: um módulo ligado ao SMCLK (TB0, I2C)
+    // não o mantém ativo em LPM3
+    UCSCTL8 &= ~SMCLKREQEN;
+    Cycles_Init();
 
-    //Pego o valor no MEM0.
-    return ADC12MEM0;
+    // --- Base de tempo das esperas curtas ---
+    Vtimer_Init();
+    PROF_INIT();
 }
 
-
 /*
- * FUNÇÃO DE ECONOMIA DE ENERGIA (LPM3)
+ * LEITURA COM ALIMENTAÇÃO CHAVEADA
  */
-void Enter_Assistive_Wait(uint16_t seconds)
-{
-    // Configura Timer0_A para contar usando ACLK (32768Hz)
-    // Queremos interrupção a cada 1 segundo.
-    // CCR0 = 32768 - 1
-    TA0CCR0 = 32767;
-    
-    // TASSEL_1 = ACLK
-    // MC_1 = Up Mode (conta até CCR0 e reseta)
-    // TACLR = Limpa o timer
-    TA0CTL = TASSEL_1 | MC_1 | TACLR;
-    
-    // Habilita interrupção do CCR0
-    TA0CCTL0 = CCIE;
 
-    while (seconds > 0)
+// Liga o sensor, espera ele estabilizar em LPM3, converte e desliga tudo.
+// Corta a corrente do sensor e do ADC durante a hibernação e reduz a
+// eletrólise da sonda.
+void Read_Sensor(uint16_t *results)
+{
+    // Sonda já ligada: um pulso de vigília acabou de cruzar o limiar e ela
+    // já estabilizou
+    if (!(P6OUT & SENSOR_PWR_PIN))
     {
-        // Entra em Low Power Mode 3 + Global Interrupt Enable
-        // CPU OFF, SMCLK OFF, ACLK ON.
-        // O programa para aqui até a interrupção do timer acontecer.
-        __bis_SR_register(LPM3_bits + GIE);
-        
-        // Ao acordar (após 1 segundo), decrementa e repete se necessário
-        seconds--;
+        P6OUT |= SENSOR_PWR_PIN;
+        Enter_Assistive_Wait_ms(SENSOR_SETTLE_MS);
     }
 
-    // Para o timer para economizar energia e limpar configurações
-    TA0CTL = MC_0;
-    TA0CCTL0 = 0;
-}
+    ADC_Power_On();
+    convert(results);
+    ADC_Power_Off();
 
-// --- INTERRUPÇÃO DO TIMER ---
-// Esta função roda a cada 1 segundo quando o timer está ativo
-#pragma vector=TIMER0_A0_VECTOR
-__interrupt void TIMER0_A0_ISR(void)
-{
-    // Acorda o processador do modo LPM3
-    // Limpa os bits LPM3 do registrador de status salvo na pilha
-    __bic_SR_register_on_exit(LPM3_bits);
+    P6OUT &= ~SENSOR_PWR_PIN;
 }
 
 /*
- * DRIVER LCD I2C
+ * HISTÓRICO E ESTATÍSTICAS
  */
 
-void LCD_Init_I2C_RegisterLevel(void)
+// Insere uma leitura feita dt_s segundos depois da anterior. Tudo em O(1):
+// nenhuma varredura da janela.
+void History_Insert(uint8_t value, uint16_t dt_s)
 {
-    UCB0CTL1 |= UCSWRST;
-    P3SEL |= BIT0 | BIT1; 
-    P3REN |= BIT0 | BIT1;
-    P3OUT |= BIT0 | BIT1;
+    uint8_t slot = history_index;
 
-    UCB0CTL0 = UCMST | UCMODE_3 | UCSYNC;
-    UCB0CTL1 = UCSSEL__SMCLK | UCTR | UCSWRST; // SMCLK 1MHz
-    UCB0BR0 = 10; 
-    UCB0BR1 = 0;
-    UCB0CTL1 &= ~UCSWRST;
-}
+    history_clock_s += dt_s;
+    uint32_t now = history_clock_s / STATS_TICK_S;
 
-void I2C_Send(uint8_t addr, uint8_t data)
-{
-    UCB0I2CSA = addr;
-    while (UCB0STAT & UCBBUSY);
-    UCB0CTL1 |= UCTXSTT | UCTR;
-    while ((UCB0IFG & UCTXIFG) == 0);
-    UCB0TXBUF = data;
-    while (UCB0CTL1 & UCTXSTT);
-    if (UCB0IFG & UCNACKIFG) {
-        UCB0CTL1 |= UCTXSTP;
-        UCB0IFG &= ~UCNACKIFG;
-    } else {
-        UCB0CTL1 |= UCTXSTP;
+    if (history_count > 0)
+    {
+        // Todas as idades crescem dt: x' = x - dt
+        uint8_t newest = slot ? slot - 1 : HISTORY_SIZE - 1;
+        int32_t dt = (int32_t)(now - history_tick[newest]);
+        stats_sum_xx += (uint32_t)(-2 * dt * stats_sum_x) + (uint32_t)history_count * dt * dt;
+        stats_sum_xy -= dt * stats_sum_y;
+        stats_sum_x -= (int32_t)history_count * dt;
     }
-    while (UCB0CTL1 & UCTXSTP);
-}
 
-void Delay_us_Custom(unsigned int time_us)
-{
-    //Configure timer A0 and starts it.
-    TA0CCR0 = time_us;
-    TA0CTL = TASSEL__SMCLK | ID__1 | MC_1 | TACLR;
+    if (history_count == HISTORY_SIZE)
+    {
+        // Sai a leitura mais antiga, que ocupa a posição a ser reescrita
+        uint8_t old = moisture_history[slot];
+        int32_t x = -(int32_t)(now - history_tick[slot]);
+        stats_sum_y -= old;
+        stats_sum_x -= x;
+        stats_sum_xx -= (uint32_t)(x * x);
+        stats_sum_xy -= x * old;
+
+        if (stats_min_len && stats_min_q[stats_min_head] == slot)
+        {
+            stats_min_head = (stats_min_head + 1) % HISTORY_SIZE;
+            stats_min_len--;
+        }
+        if (stats_max_len && stats_max_q[stats_max_head] == slot)
+        {
+            stats_max_head = (stats_max_head + 1) % HISTORY_SIZE;
+            stats_max_len--;
+        }
+    }
+    else history_count++;
+
+    // A nova leitura tem x = 0: só entra na soma de y
+    moisture_history[slot] = value;
+    history_tick[slot] = now;
+    stats_sum_y += value;
+
+    // Descarta do fim das filas quem nunca mais poderá ser mínimo/máximo
+    while (stats_min_len &&
+           moisture_history[stats_min_q[(stats_min_head + stats_min_len - 1) % HISTORY_SIZE]] >= value)
+        stats_min_len--;
+    stats_min_q[(stats_min_head + stats_min_len) % HISTORY_SIZE] = slot;
+    stats_min_len++;
+
+    while (stats_max_len &&
+           moisture_history[stats_max_q[(stats_max_head + stats_max_len - 1) % HISTORY_SIZE]] <= value)
+        stats_max_len--;
+    stats_max_q[(stats_max_head + stats_max_len) % HISTORY_SIZE] = slot;
+    stats_max_len++;
 
-    //Locks, waiting for the timer.
-    while((TA0CTL & TAIFG) == 0);
+    history_index = (slot + 1 < HISTORY_SIZE) ? slot + 1 : 0;
 
-    //Stops the timer
-    TA0CTL = MC_0 | TACLR;
+    Archive_Insert(value);
 }
 
-void LCD_Write_Nibble(uint8_t nibble, uint8_t isChar)
+uint8_t Stats_Min(void)
 {
-    uint8_t i2cValue = (nibble & 0xF0) | BL_BIT;
-    if (isChar) i2cValue |= RS_BIT;
-    else i2cValue &= ~RS_BIT;
+    return stats_min_len ? moisture_history[stats_min_q[stats_min_head]] : 0;
+}
 
-    i2cValue &= ~(RW_BIT | EN_BIT);
-    I2C_Send(LCD_ADDR, i2cValue);
-    I2C_Send(LCD_ADDR, i2cValue | EN_BIT);
-    Delay_us_Custom(10);
-    I2C_Send(LCD_ADDR, i2cValue);
-    Delay_us_Custom(50);
+uint8_t Stats_Max(void)
+{
+    return stats_max_len ? moisture_history[stats_max_q[stats_max_head]] : 0;
 }
 
-void LCD_Write_Byte(uint8_t byte, uint8_t isChar)
+uint8_t Stats_Mean(void)
 {
-    LCD_Write_Nibble(byte, isChar);
-    LCD_Write_Nibble(byte << 4, isChar);
+    if (history_count == 0) return 0;
+    return (uint8_t)((stats_sum_y + history_count / 2) / history_count);
 }
 
-void LCD_Init(void)
+// Inclinação por mínimos quadrados sobre a janela, em 0,1 %/h, toda em 32
+// bits. den = n·Σx² - (Σx)² é calculado módulo 2^32 (o valor real cabe em
+// uint32_t). Por Cauchy-Schwarz, com a umidade até 127, |num| <= 1524·√den:
+// com den < 2^24 o num·60 cabe em int32_t. Acima disso os dois são
+// divididos por 2 até caber, perdendo só bits abaixo da resolução.
+int16_t Stats_Trend(void)
 {
+    uint8_t n = history_count;
+    if (n < 2) return 0;
+
+    uint32_t den = (uint32_t)n * stats_sum_xx - (uint32_t)stats_sum_x * (uint32_t)stats_sum_x;
+    if (den == 0) return 0;  // Leituras no mesmo tick
+    int32_t num = (int32_t)n * stats_sum_xy - stats_sum_x * (int32_t)stats_sum_y;
+
+    while (den >= 0x1000000UL)
+    {
+        den >>= 1;
+        num /= 2;
+    }
+
+    int32_t trend = num * 60 / (int32_t)den;  // %/tick -> 0,1 %/h
+    if (trend > 30000) trend = 30000;
+    if (trend < -30000) trend = -30000;
+    return (int16_t)trend;
+}
+
+/*
+ * ARQUIVO EM TRÊS RESOLUÇÕES
+ */
+
+// Soma a leitura à hora aberta. Antes, fecha as horas que o relógio do
+// histórico já passou; as sem leitura repetem a última.
+void Archive_Insert(uint8_t value)
+{
+    uint32_t hour = history_clock_s / 3600;
+
+    if (!arch_started)
+    {
+        arch_started = true;
+        arch_hour = hour;
+    }
+    while (arch_hour != hour)
+    {
+        if (!arch_acc[ARCH_HOUR].n) Arch_Fold(&arch_acc[ARCH_HOUR], arch_held, arch_held, arch_held);
+        Archive_Close();
+        arch_hour++;
+    }
+    Arch_Fold(&arch_acc[ARCH_HOUR], value, value, value);
+    arch_held = value;
+}
+
+// Fecha a hora aberta e, em cascata, o dia e a semana que ela completar:
+// cada período vira um registro do seu nível e entra no acumulador do de cima
+void Archive_Close(void)
+{
+    uint8_t t;
+
+    for (t = 0; t < ARCH_TIERS; t++)
+    {
+        arch_acc_t *a = &arch_acc[t];
+        uint8_t mean = (a->sum + a->n / 2) / a->n;
+
+        Arch_Push(&arch[t], mean, a->min, a->max);
+        a->sum = 0;
+        a->n = 0;
+        if (t + 1 == ARCH_TIERS) break;
+
+        Arch_Fold(&arch_acc[t + 1], mean, a->min, a->max);
+        if (arch_acc[t + 1].n < arch_span[t + 1]) break;
+    }
+}
+
+void Arch_Fold(arch_acc_t *a, uint8_t mean, uint8_t min, uint8_t max)
+{
+    if (!a->n || min < a->min) a->min = min;
+    if (!a->n || max > a->max) a->max = max;
+    a->sum += mean;
+    a->n++;
+}
+
+// Acrescenta um registro, descartando os mais antigos enquanto o nível
+// estiver no limite ou faltar espaço para o pior caso (todos com escape).
+// Com os anéis dimensionados como acima, só o limite descarta.
+void Arch_Push(arch_ring_t *r, uint8_t mean, uint8_t min, uint8_t max)
+{
+    // Delta módulo 256, como a média: de 0 a 255 é -1, e todo delta cabe
+    // no zig-zag de 8 bits
+    int8_t delta = r->count ? (int8_t)(uint8_t)(mean - r->last) : 0;
+
+    while (r->count && (r->count >= r->limit || r->size - r->used < ARCH_WORST * r->fields))
+        Arch_Drop(r);
+    if (!r->count) r->first = mean;
+
+    Arch_Put(r, (uint8_t)(((uint8_t)delta << 1) ^ (delta >> 7)));  // Zig-zag: 0, -1, 1, -2...
+    if (r->fields == 3)
+    {
+        Arch_Put(r, mean - min);
+        Arch_Put(r, max - mean);
+    }
+    r->last = mean;
+    r->count++;
+}
+
+// Descarta o registro mais antigo; a média do seguinte vira a referência
+void Arch_Drop(arch_ring_t *r)
+{
+    uint16_t pos = r->tail, next;
+    uint8_t mean, min, max;
+
+    Arch_Decode(r, &pos, 0, &mean, &min, &max);
+    r->count--;
+    if (r->count)
+    {
+        next = pos;
+        Arch_Decode(r, &next, 1, &mean, &min, &max);
+        r->first = mean;
+    }
+    r->used -= (pos >= r->tail) ? pos - r->tail : pos + r->size - r->tail;
+    r->tail = pos;
+}
+
+// Decodifica o i-ésimo registro (a partir do mais antigo), que começa em
+// *pos, e avança *pos para o seguinte. *mean entra com a média do anterior.
+// Percorrer um nível é chamar em sequência a partir de tail.
+void Arch_Decode(const arch_ring_t *r, uint16_t *pos, uint8_t i,
+                 uint8_t *mean, uint8_t *min, uint8_t *max)
+{
+    uint8_t zz = Arch_Field(r, pos);
+    int16_t delta = (int16_t)(zz >> 1) ^ -(int16_t)(zz & 1);
+
+    *mean = i ? *mean + delta : r->first;
+    *min = *max = *mean;
+    if (r->fields == 3)
+    {
+        *min = *mean - Arch_Field(r, pos);
+        *max = *mean + Arch_Field(r, pos);
+    }
+}
+
+// Grava um valor de 0 a 255: um nibble, ou o escape e mais dois
+void Arch_Put(arch_ring_t *r, uint8_t value)
+{
+    uint8_t part[3], n = 0, i;
+
+    if (value < ARCH_ESCAPE) part[n++] = value;
+    else
+    {
+        part[n++] = ARCH_ESCAPE;
+        part[n++] = value >> 4;
+        part[n++] = value & 0x0F;
+    }
+    for (i = 0; i < n; i++)
+    {
+        uint16_t pos = r->tail + r->used;
+        uint8_t *b;
+
+        if (pos >= r->size) pos -= r->size;
+        b = &r->nib[pos >> 1];
+        *b = (pos & 1) ? (*b & 0xF0) | part[i] : (*b & 0x0F) | (part[i] << 4);
+        r->used++;
+    }
+}
+
+// Lê o valor que começa em *pos e avança *pos
+uint8_t Arch_Field(const arch_ring_t *r, uint16_t *pos)
+{
+    uint8_t part[3], n = 1, i;
+
+    for (i = 0; i < n; i++)
+    {
+        uint8_t b = r->nib[*pos >> 1];
+        part[i] = (*pos & 1) ? b & 0x0F : b >> 4;
+        if (++*pos == r->size) *pos = 0;
+        if (i == 0 && part[0] == ARCH_ESCAPE) n = 3;
+    }
+    return n == 1 ? part[0] : (part[1] << 4) | part[2];
+}
+
+#if DUMP_ENABLE
+// Formato texto (UART), do mais antigo ao mais recente:
+//   H <média> ...                    (horas)
+//   D <média>/<mínimo>/<máximo> ...  (dias; W para as semanas)
+void Archive_Dump(void)
+{
+    static const char tag[ARCH_TIERS] = { 'H', 'D', 'W' };
+    char item[16];
+    uint8_t t, i, mean = 0, min, max;
+
+    for (t = 0; t < ARCH_TIERS; t++)
+    {
+        const arch_ring_t *r = &arch[t];
+        uint16_t pos = r->tail;
+
+        item[0] = tag[t];
+        item[1] = '\0';
+        UART_Write(item);
+        for (i = 0; i < r->count; i++)
+        {
+            Arch_Decode(r, &pos, i, &mean, &min, &max);
+            if (r->fields == 1) sprintf(item, " %u", mean);
+            else sprintf(item, " %u/%u/%u", mean, min, max);
+            UART_Write(item);
+        }
+        UART_Write("\r\n");
+    }
+}
+#endif
+
+// Rótulo na linha 1; na 2, umidade atual, tendência e faixa da janela. Com
+// mais de uma zona a linha 2 mostra a umidade de cada uma.
+void Show_Moisture(const char *label)
+{
+    char buffer[40];
+#if ZONES == 1
+    int16_t trend = Stats_Trend();
+    char arrow = trend > TREND_STABLE ? '+' : (trend < -TREND_STABLE ? '-' : '=');
+
+    PROF_BEGIN(PROF_SPRINTF);
+    sprintf(buffer, "%s\n  %3u%% %c %2u-%2u", label, zones[0].pct, arrow,
+            Stats_Min(), Stats_Max());
+    PROF_END(PROF_SPRINTF);
+#else
+    char *p = buffer;
+    uint8_t z;
+
+    PROF_BEGIN(PROF_SPRINTF);
+    p += sprintf(p, "%s\n", label);
+    for (z = 0; z < ZONES; z++)
+        p += sprintf(p, "%3u%%", zones[z].pct);
+    PROF_END(PROF_SPRINTF);
+#endif
+
+    PROF_BEGIN(PROF_LCD);
+    LCD_Update(buffer);
+    PROF_END(PROF_LCD);
+}
+
+/*
+ * INTERVALO DE AMOSTRAGEM ADAPTATIVO
+ */
+
+// Intervalo pedido pela zona z. Só a zona 0 tem histórico: nas demais a
+// tendência é tomada como estável.
+uint16_t Next_Interval(uint8_t z)
+{
+    int16_t dist = (int16_t)zones[z].pct - zone_cfg[z].threshold;
+    uint16_t abs_dist = dist < 0 ? -dist : dist;
+    int16_t trend = z == 0 ? Stats_Trend() : 0;
+
+    // Cresce com a distância ao limiar
+    uint32_t interval = SAMPLE_MIN_S + (uint32_t)abs_dist * SAMPLE_S_PER_PCT;
+
+    // Indo em direção ao limiar: acorda pelo menos duas vezes antes de cruzar
+    if ((dist > 0 && trend < 0) || (dist < 0 && trend > 0))
+    {
+        uint16_t speed = trend < 0 ? -trend : trend;
+        uint32_t eta = (uint32_t)abs_dist * 36000UL / speed;
+        if (eta / 2 < interval) interval = eta / 2;
+    }
+
+    if (interval < SAMPLE_MIN_S) interval = SAMPLE_MIN_S;
+    if (interval > SAMPLE_MAX_S) interval = SAMPLE_MAX_S;
+    return (uint16_t)interval;
+}
+
+/*
+ * BOMBA
+ */
+
+// Dose da rega da zona z (décimos de segundo em regime) pela lei PI sobre o
+// déficit
+uint16_t Pump_Dose(uint8_t z)
+{
+    zone_t *zone = &zones[z];
+    int16_t deficit = zone_cfg[z].threshold + PUMP_MARGIN - (int16_t)zone->pct;
+    int16_t dose;
+
+    if (deficit < 0) deficit = 0;
+    dose = PUMP_KP_DS * deficit + PUMP_KI_DS * zone->pump_integral;
+
+    zone->pump_integral += deficit;
+    if (zone->pump_integral > PUMP_INTEGRAL_MAX) zone->pump_integral = PUMP_INTEGRAL_MAX;
+
+    if (dose < PUMP_DOSE_MIN_DS) dose = PUMP_DOSE_MIN_DS;
+    if (dose > PUMP_DOSE_MAX_DS) dose = PUMP_DOSE_MAX_DS;
+    return (uint16_t)dose;
+}
+
+// A cada leitura: o que passa do alvo desconta o acumulado
+void Pump_Track(uint8_t z)
+{
+    zone_t *zone = &zones[z];
+    uint8_t target = zone_cfg[z].threshold + PUMP_MARGIN;
+
+    if (zone->pct <= target) return;
+    zone->pump_integral -= zone->pct - target;
+    if (zone->pump_integral < 0) zone->pump_integral = 0;
+}
+
+// Corrente da bomba da zona z em regime
+uint16_t Pump_Current(uint8_t z)
+{
+    if (zone_cfg[z].pwm) return (uint32_t)PUMP_CURRENT_MA * PUMP_DUTY_PCT / 100;
+    return PUMP_CURRENT_MA;
+}
+
+void ADC_Power_On(void)
+{
+#if ADC_USE_REF
+    // Referência interna ligada só para esta leitura
+    REFCTL0 = (REFCTL0 & ~REFVSEL_3) | REFMSTR | REFVSEL_2 | REFON;
+    Delay_us_Custom(ADC_REF_SETTLE_US);
+#endif
+    ADC12CTL0 |= ADC12ON;
+    ADC12CTL0 |= ADC12ENC;
+}
+
+void ADC_Power_Off(void)
+{
+    ADC12CTL0 &= ~ADC12ENC;
+    ADC12CTL0 &= ~ADC12ON;
+#if ADC_USE_REF
+    REFCTL0 &= ~REFON;
+#endif
+}
+
+/*
+ * FUNÇÃO DE CONVERSÃO DO ADC
+ */
+// Converte a sequência inteira e deixa em results[z] a leitura filtrada de
+// cada zona
+void convert(uint16_t *results)
+{
+    uint16_t samples[ADC_SEQUENCE];
+    uint8_t i;
+
+    ADC_Run();
+
+    //Pego os valores de MEM0 a MEM[ADC_SEQUENCE-1] (a leitura limpa os flags)
+    for (i = 0; i < ADC_SEQUENCE; i++)
+        samples[i] = (&ADC12MEM0)[i];
+
+    for (i = 0; i < ZONES; i++)
+        results[i] = ADC_Reduce(&samples[i * ADC_SAMPLES]);
+}
+
+// Dispara a conversão e dorme até o fim dela
+void ADC_Run(void)
+{
+    adc_done = false;
+    ADC12IFG = 0;
+
+    //Faço o rising edge no ADC12SC (conversão manual).
+    //Com ADC12MSC as demais conversões seguem sozinhas até o EOS.
+    ADC12CTL0 &= ~ADC12SC;
+    ADC12CTL0 |= ADC12SC;
+
+    //Aguardo em LPM0 (SMCLK segue alimentando o ADC) a interrupção de fim
+    //de sequência, em vez de um atraso fixo
+    __disable_interrupt();
+    while (!adc_done)
+    {
+        __bis_SR_register(LPM0_bits + GIE);
+        energy.wakeups++;
+        __disable_interrupt();
+    }
+    __enable_interrupt();
+}
+
+// Ordena as ADC_SAMPLES amostras de uma zona (inserção: N <= 16) e aplica o
+// filtro configurado.
+// Uma amostra ruidosa isolada não consegue mais disparar a bomba.
+uint16_t ADC_Reduce(uint16_t *samples)
+{
+    uint8_t i, j;
+    for (i = 1; i < ADC_SAMPLES; i++)
+    {
+        uint16_t v = samples[i];
+        for (j = i; j > 0 && samples[j - 1] > v; j--)
+            samples[j] = samples[j - 1];
+        samples[j] = v;
+    }
+
+#if ADC_FILTER == ADC_FILTER_MEDIAN
+    if (ADC_SAMPLES & 1) return samples[ADC_SAMPLES / 2];
+    return (samples[ADC_SAMPLES / 2 - 1] + samples[ADC_SAMPLES / 2] + 1) / 2;
+#else
+    uint16_t sum = 0;
+    for (i = ADC_TRIM; i < ADC_SAMPLES - ADC_TRIM; i++)
+        sum += samples[i];
+    return (sum + (ADC_SAMPLES - 2 * ADC_TRIM) / 2) / (ADC_SAMPLES - 2 * ADC_TRIM);
+#endif
+}
+
+// --- INTERRUPÇÃO DO ADC12 ---
+// Só a última posição da sequência (ou a da medida de AVCC) está
+// habilitada: acorda o ADC_Run()
+#pragma vector=ADC12_VECTOR
+__interrupt void ADC12_ISR(void)
+{
+    uint16_t iv = ADC12IV;
+
+    if (iv == ADC_LAST_IV || iv == ADC_SUPPLY_IV)
+    {
+        adc_done = true;
+        __bic_SR_register_on_exit(LPM0_bits);
+    }
+}
+
+/*
+ * ESCALONADOR
+ */
+
+// RTC_A em modo contador: ACLK direto, evento no estouro de 32 bits. Ele
+// roda sem parar e é a base de tempo do escalonador.
+void Sched_Init(void)
+{
+    uint8_t t;
+
+    RTCCTL01 = RTCHOLD | RTCSSEL_0 | RTCTEV_3;
+    RTCNT12 = 0;
+    RTCNT34 = 0;
+    sched_epoch = 0;
+    sched_armed = 0;
+    RTCCTL01 = RTCSSEL_0 | RTCTEV_3 | RTCTEVIE;
+
+    sched_head = SCHED_NONE;
+    for (t = 0; t < TASKS; t++) sched_next[t] = SCHED_NONE;
+}
+
+// Agora, em ciclos de ACLK. O RTC_A anda no ACLK, assíncrono ao da CPU:
+// uma leitura no meio da contagem pode vir corrompida, então a metade
+// baixa é lida até duas leituras coincidirem (como o TA2R em Vtimer_Now)
+// e a alta confere que não houve vai-um entre as duas metades.
+RAMFUNC uint32_t Sched_Now(void)
+{
+    uint16_t hi, lo;
+    do
+    {
+        hi = RTCNT34;
+        do lo = RTCNT12; while (lo != RTCNT12);
+    } while (hi != RTCNT34);
+    return sched_epoch + (((uint32_t)hi << 16) | lo);
+}
+
+// Programa o estouro do RTC para 'deadline': o contador é recarregado com
+// -(deadline - agora) e a época passa a ser o próprio prazo. Retorna false
+// se o prazo já passou.
+bool Sched_Arm(uint32_t deadline)
+{
+    uint32_t now = Sched_Now();
+    int32_t ahead = (int32_t)(deadline - now);
+
+    if (ahead <= 0) return false;
+    if (deadline == sched_armed) return true;
+
+    // O contador só pode ser carregado parado (RTCHOLD)
+    RTCCTL01 |= RTCHOLD;
+    RTCNT12 = (uint16_t)(0 - (uint32_t)ahead);
+    RTCNT34 = (uint16_t)((0 - (uint32_t)ahead) >> 16);
+    sched_epoch = deadline;
+    sched_armed = deadline;
+    RTCCTL01 = RTCSSEL_0 | RTCTEV_3 | RTCTEVIE;
+    return true;
+}
+
+// Insere a tarefa na fila de prazos, depois das que vencem no mesmo instante
+void Sched_At(uint8_t task, uint32_t deadline)
+{
+    uint8_t *p = &sched_head;
+
+    Sched_Cancel(task);
+    sched_deadline[task] = deadline;
+    while (*p != SCHED_NONE && (int32_t)(sched_deadline[*p] - deadline) <= 0)
+        p = &sched_next[*p];
+    sched_next[task] = *p;
+    *p = task;
+}
+
+void Sched_After(uint8_t task, uint32_t ticks)
+{
+    Sched_At(task, Sched_Now() + ticks);
+}
+
+void Sched_Cancel(uint8_t task)
+{
+    uint8_t *p = &sched_head;
+
+    while (*p != SCHED_NONE)
+    {
+        if (*p == task)
+        {
+            *p = sched_next[task];
+            return;
+        }
+        p = &sched_next[*p];
+    }
+}
+
+// Marca a tarefa como pronta. Pode ser chamada por ISRs: do main, a
+// leitura-modificação-escrita roda com as interrupções desabilitadas.
+void Sched_Post(uint8_t task)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+
+    __disable_interrupt();
+    sched_ready |= 1U << task;
+    if (gie) __enable_interrupt();
+}
+
+// Passa para o conjunto de prontas as tarefas com prazo vencido
+RAMFUNC void Sched_Expire(void)
+{
+    uint32_t now = Sched_Now();
+
+    while (sched_head != SCHED_NONE && (int32_t)(sched_deadline[sched_head] - now) <= 0)
+    {
+        uint8_t task = sched_head;
+        sched_head = sched_next[task];
+        sched_next[task] = SCHED_NONE;
+        Sched_Post(task);
+    }
+}
+
+// Dorme até o próximo evento. Chamada com as interrupções desabilitadas;
+// retorna com elas habilitadas.
+RAMFUNC void Sched_Idle(void)
+{
+    // O USCI_B0 usa SMCLK, que para em LPM3: com a fila do LCD andando
+    // dorme em LPM0 e a ISR do I2C acorda a CPU ao esvaziar
+    I2C_Kick();
+    if (!i2c_idle)
+    {
+        __bis_SR_register(LPM0_bits + GIE);
+        energy.wakeups++;
+        return;
+    }
+
+    // Fila vazia; o STOP do último quadro ainda pode estar saindo
+    while (UCB0CTL1 & UCTXSTP);
+
+    // Nada vence antes do estouro do RTC (ou de um evento de ISR)
+    if (sched_head != SCHED_NONE && !Sched_Arm(sched_deadline[sched_head]))
+    {
+        __enable_interrupt();
+        return;
+    }
+
+    // CPU OFF, SMCLK OFF, ACLK ON até o estouro
+    uint32_t start = Sched_Now();
+    __bis_SR_register(LPM3_bits + GIE);
+    energy.wakeups++;
+
+    uint32_t slept = Sched_Now() - start;
+    energy.lpm3_s += slept >> 15;
+    Energy_Add_LPM3_ms((uint16_t)(((slept & 0x7FFF) * 1000) >> 15));
+}
+
+// Laço principal: roda as tarefas prontas por ordem de número e dorme
+// quando não sobra nenhuma
+void Sched_Run(void)
+{
+    while (1)
+    {
+        uint16_t ready;
+        uint8_t task;
+
+        Sched_Expire();
+
+        __disable_interrupt();
+        ready = sched_ready;
+        sched_ready = 0;
+        if (!ready)
+        {
+            Sched_Idle();
+            continue;
+        }
+        __enable_interrupt();
+
+        for (task = 0; task < TASKS; task++)
+        {
+            if (!(ready & (1U << task))) continue;
+            switch (task)
+            {
+            case TASK_SENSE:     Task_Sense();     break;
+            case TASK_DISPLAY:   Task_Display();   break;
+            case TASK_TELEMETRY: Task_Telemetry(); break;
+            case TASK_SERVICE:   Task_Service();   break;
+            case TASK_BACKLIGHT: Task_Backlight(); break;
+            case TASK_WATCH:     Task_Watch();     break;
+            default:             Task_Pump(task - TASK_PUMP); break;
+            }
+        }
+    }
+}
+
+// Espera curta em LPM3 (resolução de 1 ciclo de ACLK)
+void Enter_Assistive_Wait_ms(uint16_t ms)
+{
+    // ms * 32768 / 1000 ciclos de ACLK, arredondado para cima
+    uint32_t ticks = ((uint32_t)ms * 32768UL + 999) / 1000;
+    if (ticks == 0) return;
+
+    Vtimer_Wait(VTIMER_WAIT, ticks);
+    Energy_Add_LPM3_ms(ms);
+}
+
+// --- INTERRUPÇÕES DOS BOTÕES ---
+// Só registram o toque e acordam o escalonador; Task_Backlight faz o resto
+#pragma vector=PORT1_VECTOR
+__interrupt void PORT1_ISR(void)
+{
+    switch (__even_in_range(P1IV, 16))
+    {
+    case 4: // P1IFG.1: S2
+        bl_touched = true;
+        Sched_Post(TASK_BACKLIGHT);
+        __bic_SR_register_on_exit(LPM3_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+#pragma vector=PORT2_VECTOR
+__interrupt void PORT2_ISR(void)
+{
+    switch (__even_in_range(P2IV, 16))
+    {
+    case 4: // P2IFG.1: S1
+        bl_touched = true;
+        Sched_Post(TASK_BACKLIGHT);
+        __bic_SR_register_on_exit(LPM3_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+// --- INTERRUPÇÃO DO RTC_A ---
+// Estouro do contador: venceu o prazo armado pelo escalonador
+#pragma vector=RTC_VECTOR
+RAMFUNC __interrupt void RTC_ISR(void)
+{
+    switch (__even_in_range(RTCIV, 16))
+    {
+    case 4: // RTCTEVIFG
+        __bic_SR_register_on_exit(LPM3_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * TEMPORIZADORES VIRTUAIS
+ */
+
+void Vtimer_Init(void)
+{
+    uint8_t t;
+
+    TA2CCTL0 = 0;
+    TA2CTL = TASSEL__ACLK | MC__CONTINOUS | TACLR;
+
+    vtimer_head = VTIMER_NONE;
+    for (t = 0; t < VTIMERS; t++) vtimer_next[t] = VTIMER_NONE;
+}
+
+// Agora, em ciclos de ACLK. Chamada com as interrupções desabilitadas: um
+// estouro ainda não atendido pela ISR é somado aqui. O TA2R anda num clock
+// assíncrono ao da CPU, então é lido até duas leituras coincidirem.
+RAMFUNC uint32_t Vtimer_Now(void)
+{
+    uint16_t hi = vtimer_overflows, lo;
+
+    do lo = TA2R; while (lo != TA2R);
+    if ((TA2CTL & (TAIFG | TAIE)) == (TAIFG | TAIE) && lo < 0x8000) hi++;
+    return ((uint32_t)hi << 16) | lo;
+}
+
+// Dispara o temporizador 'id' daqui a 'ticks' ciclos de ACLK, depois dos
+// que vencem no mesmo instante. Pode ser chamada por ISRs.
+void Vtimer_After(uint8_t id, uint32_t ticks)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    uint8_t *p = &vtimer_head;
+    uint32_t deadline;
+
+    __disable_interrupt();
+    Vtimer_Unlink(id);
+    vtimer_fired &= ~(1 << id);
+
+    // Lista vazia: a parte alta volta a contar a partir de um TAIFG limpo
+    if (vtimer_head == VTIMER_NONE) TA2CTL = (TA2CTL & ~TAIFG) | TAIE;
+
+    deadline = Vtimer_Now() + ticks;
+    vtimer_deadline[id] = deadline;
+    while (*p != VTIMER_NONE && (int32_t)(vtimer_deadline[*p] - deadline) <= 0)
+        p = &vtimer_next[*p];
+    vtimer_next[id] = *p;
+    *p = id;
+
+    Vtimer_Arm();
+    if (gie) __enable_interrupt();
+}
+
+void Vtimer_Cancel(uint8_t id)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+
+    __disable_interrupt();
+    Vtimer_Unlink(id);
+    vtimer_fired &= ~(1 << id);
+    Vtimer_Arm();
+    if (gie) __enable_interrupt();
+}
+
+// Tira 'id' da lista, se estiver nela (interrupções desabilitadas)
+void Vtimer_Unlink(uint8_t id)
+{
+    uint8_t *p = &vtimer_head;
+
+    while (*p != VTIMER_NONE)
+    {
+        if (*p == id)
+        {
+            *p = vtimer_next[id];
+            vtimer_next[id] = VTIMER_NONE;
+            return;
+        }
+        p = &vtimer_next[*p];
+    }
+}
+
+// Leva o TA2CCR0 ao primeiro prazo da lista (interrupções desabilitadas).
+// Um prazo a mais de 16 bits espera o estouro que o traz para perto; um que
+// já venceu, ou venceu durante a programação, liga o CCIFG por software.
+RAMFUNC void Vtimer_Arm(void)
+{
+    uint32_t deadline;
+
+    if (vtimer_head == VTIMER_NONE)
+    {
+        TA2CCTL0 = 0;
+        TA2CTL &= ~TAIE;
+        return;
+    }
+
+    deadline = vtimer_deadline[vtimer_head];
+    if ((int32_t)(deadline - Vtimer_Now()) > 0xFFFF)
+    {
+        TA2CCTL0 = 0;
+        return;
+    }
+
+    TA2CCR0 = (uint16_t)deadline;
+    TA2CCTL0 = CCIE;
+    if ((int32_t)(deadline - Vtimer_Now()) <= 0) TA2CCTL0 = CCIE | CCIFG;
+}
+
+// Dorme em LPM3 até o temporizador 'id' vencer. Outras ISRs que acordem a
+// CPU no meio (RTC do escalonador, UART) só fazem o laço voltar a dormir.
+void Vtimer_Wait(uint8_t id, uint32_t ticks)
+{
+    // O I2C usa SMCLK, que para em LPM3: a fila do LCD esvazia antes
+    I2C_Wait_Idle();
+    Vtimer_After(id, ticks);
+
+    __disable_interrupt();
+    while (!(vtimer_fired & (1 << id)))
+    {
+        __bis_SR_register(LPM3_bits + GIE);
+        energy.wakeups++;
+        __disable_interrupt();
+    }
+    vtimer_fired &= ~(1 << id);
+    __enable_interrupt();
+}
+
+// --- INTERRUPÇÕES DO TIMER_A2 ---
+// CCR0: venceu o primeiro prazo. Marca os vencidos, rearma para o próximo
+// e acorda a CPU.
+#pragma vector=TIMER2_A0_VECTOR
+RAMFUNC __interrupt void TIMER2_A0_ISR(void)
+{
+    uint32_t now = Vtimer_Now();
+
+    while (vtimer_head != VTIMER_NONE && (int32_t)(vtimer_deadline[vtimer_head] - now) <= 0)
+    {
+        uint8_t id = vtimer_head;
+        vtimer_head = vtimer_next[id];
+        vtimer_next[id] = VTIMER_NONE;
+        vtimer_fired |= 1 << id;
+    }
+    Vtimer_Arm();
+
+    __bic_SR_register_on_exit(LPM3_bits);
+}
+
+#pragma vector=TIMER2_A1_VECTOR
+RAMFUNC __interrupt void TIMER2_A1_ISR(void)
+{
+    switch (__even_in_range(TA2IV, 14))
+    {
+    case 14: // TAIFG: estouro, o primeiro prazo pode ter entrado na janela
+        vtimer_overflows++;
+        Vtimer_Arm();
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * UART DE BACKCHANNEL (USCI_A1)
+ */
+
+#ifdef UART_ENABLE
+// P4.4 = TXD, P4.5 = RXD, ligados à ponte USB do LaunchPad.
+// 9600 baud a partir do ACLK de 32768 Hz (UCBR = 3, UCBRS = 3): a UART
+// continua transmitindo em LPM3.
+void UART_Init(void)
+{
+    UCA1CTL1 |= UCSWRST;
+    P4SEL |= BIT4 | BIT5;
+
+    UCA1CTL1 = UCSSEL__ACLK | UCSWRST;
+    UCA1BR0 = 3;
+    UCA1BR1 = 0;
+    UCA1MCTL = UCBRS_3 | UCBRF_0;
+    UCA1CTL1 &= ~UCSWRST;
+}
+
+// Envio bloqueante, usado apenas para despejos de depuração
+void UART_Write(const char *str)
+{
+#ifdef UART_DMA_ENABLE
+    UART_Wait_Idle();  // Não intercala bytes com um quadro saindo por DMA
+#endif
+    while (*str)
+    {
+        while ((UCA1IFG & UCTXIFG) == 0);
+        UCA1TXBUF = *str++;
+    }
+}
+#endif
+
+#ifdef UART_DMA_ENABLE
+// CRC-16-CCITT bit a bit: ~25 bytes por leitura não justificam uma tabela
+uint16_t CRC16_Update(uint16_t crc, uint8_t byte)
+{
+    uint8_t i;
+    crc ^= (uint16_t)byte << 8;
+    for (i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    return crc;
+}
+
+uint8_t *Put_LE(uint8_t *p, uint32_t value, uint8_t bytes)
+{
+    while (bytes--)
+    {
+        *p++ = (uint8_t)value;
+        value >>= 8;
+    }
+    return p;
+}
+
+// DMAEN cai sozinho depois da última transferência (modo único)
+void UART_Wait_Idle(void)
+{
+    while (DMA0CTL & DMAEN);
+}
+
+// Entrega o quadro ao DMA e retorna logo: o envio segue em LPM3, com o DMA
+// pedindo o MCLK só durante cada transferência. data precisa continuar
+// válido até o fim (UART_Wait_Idle).
+void UART_Send_DMA(const uint8_t *data, uint8_t len)
+{
+    // Canal 0: byte a byte do quadro para o UCA1TXBUF, disparado por UCTXIFG
+    DMACTL0 = DMA0TSEL__UCA1TXIFG;
+    __data16_write_addr((unsigned short)&DMA0SA, (unsigned long)data);
+    __data16_write_addr((unsigned short)&DMA0DA, (unsigned long)&UCA1TXBUF);
+    DMA0SZ = len;
+    DMA0CTL = DMADT_0 | DMASRCINCR_3 | DMADSTINCR_0 | DMASBDB | DMAEN;
+
+    // O gatilho é por borda e UCTXIFG já está em 1: refaz a borda
+    UCA1IFG &= ~UCTXIFG;
+    UCA1IFG |= UCTXIFG;
+}
+#endif
+
+#ifdef TELEMETRY_ENABLE
+
+// Monta o quadro e entrega ao DMA
+void Telemetry_Send(void)
+{
+    uint8_t *p = telem_frame;
+    uint32_t minute = log_minute_base + history_clock_s / 60;
+    uint32_t dry_min = zones[0].dry_streak ? zones[0].dry_seconds / 60 : 0;
+    uint16_t crc = 0xFFFF;
+    uint8_t flags = 0, i;
+
+    if (zones[0].dry_streak) flags |= TELEM_DRY;
+    if (zones[0].pump_state != PUMP_IDLE) flags |= TELEM_PUMPED;
+    if (telem_seq == 0) flags |= TELEM_BOOT;
+
+    UART_Wait_Idle();  // O quadro anterior ainda pode estar saindo
+
+    *p++ = TELEM_SYNC;
+    *p++ = TELEM_PAYLOAD;
+    *p++ = TELEM_VERSION;
+    p = Put_LE(p, telem_seq++, 2);
+    p = Put_LE(p, minute, 4);
+    *p++ = zones[0].pct;
+    *p++ = Stats_Min();
+    *p++ = Stats_Max();
+    *p++ = Stats_Mean();
+    p = Put_LE(p, (uint16_t)Stats_Trend(), 2);
+    p = Put_LE(p, dry_min > 0xFFFF ? 0xFFFF : dry_min, 2);
+    p = Put_LE(p, sample_interval_s, 2);
+    *p++ = flags;
+    p = Put_LE(p, energy.pump_s, 4);
+    for (i = 1; i < TELEM_PAYLOAD + 2; i++) crc = CRC16_Update(crc, telem_frame[i]);
+    Put_LE(p, crc, 2);
+
+    UART_Send_DMA(telem_frame, TELEM_FRAME);
+}
+#endif
+
+/*
+ * LOG TOKENIZADO
+ */
+#if TRACE_ENABLE
+
+// Grava um registro; com o anel cheio só conta a perda. Pode ser chamada
+// por ISRs.
+void Trace_Put(uint16_t token, const uint16_t *args, uint8_t n)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    uint8_t i;
+
+    __disable_interrupt();
+    if (TRACE_RING_SIZE - (uint8_t)(trace.head - trace.tail) < 3 + 2 * n) trace.dropped++;
+    else
+    {
+        trace.ring[trace.head++ & TRACE_MASK] = (uint8_t)token;
+        trace.ring[trace.head++ & TRACE_MASK] = token >> 8;
+        trace.ring[trace.head++ & TRACE_MASK] = n;
+        for (i = 0; i < n; i++)
+        {
+            trace.ring[trace.head++ & TRACE_MASK] = (uint8_t)args[i];
+            trace.ring[trace.head++ & TRACE_MASK] = args[i] >> 8;
+        }
+    }
+    if (gie) __enable_interrupt();
+}
+
+// Despeja o anel quando passa da metade ou quando há registro esperando
+// há TRACE_FLUSH_S. Com um quadro de telemetria saindo, tenta logo depois.
+void Trace_Service(void)
+{
+    uint8_t used = trace.head - trace.tail;
+
+    if (!used && !trace.dropped) return;
+    if (used < TRACE_FLUSH_BYTES && history_clock_s - trace_flushed_s < TRACE_FLUSH_S) return;
+    if (DMA0CTL & DMAEN)
+    {
+        Sched_After(TASK_SERVICE, SCHED_MS(TRACE_RETRY_MS));
+        return;
+    }
+    Trace_Flush();
+}
+
+// Copia os registros para o quadro, esvazia o anel e entrega ao DMA
+void Trace_Flush(void)
+{
+    uint8_t *p = trace_frame + 2;
+    uint16_t crc = 0xFFFF, gie;
+    uint8_t used, i;
+
+    UART_Wait_Idle();
+    *p++ = TRACE_VERSION;
+    p = Put_LE(p, TRACE_DICT_ID, 2);
+    p = Put_LE(p, trace_seq++, 2);
+    p = Put_LE(p, log_minute_base + history_clock_s / 60, 4);
+
+    gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    p = Put_LE(p, trace.dropped, 2);
+    used = trace.head - trace.tail;
+    for (i = 0; i < used; i++) *p++ = trace.ring[(uint8_t)(trace.tail + i) & TRACE_MASK];
+    trace.tail = trace.head;
+    trace.dropped = 0;
+    if (gie) __enable_interrupt();
+
+    trace_frame[0] = TRACE_SYNC;
+    trace_frame[1] = TRACE_HEADER + used;
+    for (i = 1; i < TRACE_HEADER + used + 2; i++) crc = CRC16_Update(crc, trace_frame[i]);
+    p = Put_LE(p, crc, 2);
+
+    UART_Send_DMA(trace_frame, p - trace_frame);
+    trace_flushed_s = history_clock_s;
+}
+#endif
+
+/*
+ * PERFILAMENTO
+ */
+#ifdef PROFILE_ENABLE
+
+// Os carimbos vêm do contador de ciclos acordado (Cycles_Now)
+void Prof_Init(void)
+{
+    uint8_t i;
+    for (i = 0; i < PROF_SECTIONS; i++)
+    {
+        prof_min[i] = 0xFFFFFFFF;
+        prof_max[i] = 0;
+        prof_total[i] = 0;
+        prof_count[i] = 0;
+    }
+}
+
+void Prof_Begin(uint8_t section)
+{
+    uint32_t now = Cycles_Now();
+    prof_start[section] = now;
+    prof_trace_id[prof_trace_head] = section;
+    prof_trace_stamp[prof_trace_head] = now;
+    prof_trace_head = (prof_trace_head + 1) & (PROF_TRACE_SIZE - 1);
+}
+
+void Prof_End(uint8_t section)
+{
+    uint32_t now = Cycles_Now();
+    uint32_t cycles = now - prof_start[section];
+
+    if (cycles < prof_min[section]) prof_min[section] = cycles;
+    if (cycles > prof_max[section]) prof_max[section] = cycles;
+    prof_total[section] += cycles;
+    prof_count[section]++;
+
+    prof_trace_id[prof_trace_head] = section | 0x80;
+    prof_trace_stamp[prof_trace_head] = now;
+    prof_trace_head = (prof_trace_head + 1) & (PROF_TRACE_SIZE - 1);
+}
+
+// Formato texto, uma linha por seção e uma por evento do trace:
+//   P <seção> <n> <min> <max> <total>
+//   T <seção> <B|E> <carimbo>
+void Prof_Dump(void)
+{
+    char line[64];
+    uint8_t i, idx;
+
+    for (i = 0; i < PROF_SECTIONS; i++)
+    {
+        sprintf(line, "P %s %u %lu %lu %lu\r\n", prof_names[i], prof_count[i],
+                prof_count[i] ? (unsigned long)prof_min[i] : 0UL,
+                (unsigned long)prof_max[i], (unsigned long)prof_total[i]);
+        UART_Write(line);
+    }
+
+    // Do evento mais antigo para o mais recente
+    idx = prof_trace_head;
+    for (i = 0; i < PROF_TRACE_SIZE; i++)
+    {
+        uint8_t id = prof_trace_id[idx];
+        if (prof_trace_stamp[idx] != 0)
+        {
+            sprintf(line, "T %s %c %lu\r\n", prof_names[id & 0x7F],
+                    (id & 0x80) ? 'E' : 'B', (unsigned long)prof_trace_stamp[idx]);
+            UART_Write(line);
+        }
+        idx = (idx + 1) & (PROF_TRACE_SIZE - 1);
+    }
+}
+
+#endif
+
+/*
+ * PERFIS DE CLOCK (UCS + PMM)
+ */
+
+// Liga o XT1 (P5.4/P5.5) e espera o cristal estabilizar em LPM3, com o ACLK
+// ainda vindo do REFO. Com ele o RTC ganha precisão de cristal e o REFO
+// desliga em LPM3. Se não oscilar, ACLK e FLL ficam no REFO de vez.
+void Clock_Init(void)
+{
+    uint16_t waited = 0;
+
+    P5SEL |= BIT4 | BIT5;
+    UCSCTL6 = (UCSCTL6 & ~XT1OFF) | XCAP_3;  // Capacitores internos de 12 pF
+
+    for (;;)
+    {
+        UCSCTL7 &= ~(XT2OFFG | XT1LFOFFG | DCOFFG);
+        SFRIFG1 &= ~OFIFG;
+        if (!(UCSCTL7 & XT1LFOFFG) || waited >= XT1_START_MS) break;
+        Enter_Assistive_Wait_ms(10);
+        waited += 10;
+    }
+
+    if (UCSCTL7 & XT1LFOFFG)
+    {
+        TRACE0("XT1 parado: ACLK e FLL no REFO");
+        UCSCTL6 |= XT1OFF;
+        P5SEL &= ~(BIT4 | BIT5);
+        UCSCTL3 = SELREF__REFOCLK | FLLREFDIV_0;
+        UCSCTL4 = SELA__REFOCLK | SELS__DCOCLKDIV | SELM__DCOCLKDIV;
+    }
+    else
+    {
+        // Oscilando, o menor drive basta
+        UCSCTL6 &= ~XT1DRIVE_3;
+    }
+}
+
+// Troca o perfil de clock. O Vcore sobe antes de acelerar e desce depois de
+// frear, um nível por vez. Os divisores que dependem do SMCLK (I2C e ADC12)
+// passam a valer para a nova frequência.
+void Clock_Set(uint8_t profile)
+{
+    const clock_profile_t *p = &clock_profiles[profile];
+
+    // Nenhuma transferência pode estar usando o SMCLK durante a troca
+    I2C_Wait_Idle();
+    Energy_Update_Active();  // Ciclos até aqui valem na frequência antiga
+
+    while ((PMMCTL0 & PMMCOREV_3) < p->corev) PMM_Step_Up();
+
+    __bis_SR_register(SCG0);  // FLL parado enquanto muda
+    UCSCTL0 = 0;              // DCOx/MODx mínimos; o FLL sobe a partir daí
+    UCSCTL1 = p->dcorsel;
+    UCSCTL2 = FLLD_1 | p->flln;
+    __bic_SR_register(SCG0);
+
+    // Até 32 x 32 ciclos de referência para travar (~31 ms no pior caso)
+    do
+    {
+        UCSCTL7 &= ~(XT2OFFG | XT1LFOFFG | DCOFFG);
+        SFRIFG1 &= ~OFIFG;
+    } while (UCSCTL7 & DCOFFG);
+
+    while ((PMMCTL0 & PMMCOREV_3) > p->corev) PMM_Step_Down();
+
+    clock_profile = profile;
+    clock_smclk_hz = 32768UL * (p->flln + 1);
+    clock_smclk_per_ms = clock_smclk_hz / 1000;
+
+    I2C_Set_Rate();
+
+    // ADC12ENC está em 0 entre leituras, então SHT e DIV podem mudar
+    ADC12CTL0 = (ADC12CTL0 & ~(ADC12SHT0_15 | ADC12SHT1_15)) | p->adc_sht;
+    ADC12CTL1 = (ADC12CTL1 & ~ADC12DIV_7) | p->adc_div;
+}
+
+// Sobe o Vcore um nível: SVS/SVM do lado alto primeiro, depois o SVM do
+// lado baixo acompanha o novo nível antes de mudar PMMCOREV
+void PMM_Step_Up(void)
+{
+    uint16_t level = (PMMCTL0 & PMMCOREV_3) + 1;
+
+    PMMCTL0_H = PMMPW_H;
+    SVSMHCTL = SVSHE | SVSHRVL0 * level | SVMHE | SVSMHRRL0 * level;
+    PMMIFG &= ~(SVSMLDLYIFG | SVMLVLRIFG | SVMLIFG);
+    SVSMLCTL = SVSLE | SVMLE | SVSMLRRL0 * level;
+    while (!(PMMIFG & SVSMLDLYIFG));
+
+    PMMCTL0 = PMMPW | level;
+
+    // Espera o Vcore chegar ao nível se o SVM ainda o vê abaixo
+    if (PMMIFG & SVMLIFG)
+        while (!(PMMIFG & SVMLVLRIFG));
+
+    SVSMLCTL = SVSLE | SVSLRVL0 * level | SVMLE | SVSMLRRL0 * level;
+    PMMCTL0_H = 0x00;
+}
+
+// Desce o Vcore um nível: o SVS/SVM do lado baixo desce antes de PMMCOREV
+void PMM_Step_Down(void)
+{
+    uint16_t level = (PMMCTL0 & PMMCOREV_3) - 1;
+
+    PMMCTL0_H = PMMPW_H;
+    PMMIFG &= ~SVSMLDLYIFG;
+    SVSMLCTL = SVSLE | SVSLRVL0 * level | SVMLE | SVSMLRRL0 * level;
+    while (!(PMMIFG & SVSMLDLYIFG));
+
+    PMMCTL0 = PMMPW | level;
+    SVSMHCTL = SVSHE | SVSHRVL0 * level | SVMHE | SVSMHRRL0 * level;
+    PMMCTL0_H = 0x00;
+}
+
+/*
+ * CONTADOR DE CICLOS ACORDADO
+ */
+
+void Cycles_Init(void)
+{
+    TB0CTL = TBSSEL__SMCLK | MC__CONTINOUS | TBCLR | TBIE;
+}
+
+// Carimbo de 32 bits: repete a leitura se houve estouro no meio
+uint32_t Cycles_Now(void)
+{
+    uint16_t high, low;
+    do
+    {
+        high = cycle_overflows;
+        low = TB0R;
+    } while (high != cycle_overflows);
+    return ((uint32_t)high << 16) | low;
+}
+
+// --- INTERRUPÇÃO DE ESTOURO DO TIMER_B0 ---
+#pragma vector=TIMER0_B1_VECTOR
+__interrupt void TIMER0_B1_ISR(void)
+{
+    switch (__even_in_range(TB0IV, 14))
+    {
+    case 14: // TBIFG: estouro do contador
+        cycle_overflows++;
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * CONTABILIDADE DE ENERGIA
+ */
+
+uint16_t Energy_Checksum(const energy_t *e)
+{
+    const uint16_t *w = (const uint16_t *)e;
+    uint16_t sum = 0;
+    uint8_t i;
+    for (i = 0; i < ENERGY_SUM_WORDS; i++)
+        sum += w[i];
+    return ~sum;
+}
+
+// Escolhe o registro válido mais recente entre os segmentos D e C
+void Energy_Load(void)
+{
+    const energy_t *d = (const energy_t *)INFO_D;
+    const energy_t *c = (const energy_t *)INFO_C;
+    bool d_ok = d->magic == ENERGY_MAGIC && d->checksum == Energy_Checksum(d);
+    bool c_ok = c->magic == ENERGY_MAGIC && c->checksum == Energy_Checksum(c);
+
+    if (d_ok && (!c_ok || (int16_t)(d->seq - c->seq) > 0))
+    {
+        energy = *d;
+        energy_next_seg = INFO_C;
+    }
+    else if (c_ok)
+    {
+        energy = *c;
+        energy_next_seg = INFO_D;
+    }
+    else
+    {
+        // Nada gravado ainda (ou os dois registros corrompidos)
+        uint8_t *p = (uint8_t *)&energy;
+        uint8_t i;
+        for (i = 0; i < sizeof(energy); i++) p[i] = 0;
+        energy.magic = ENERGY_MAGIC;
+        energy_next_seg = INFO_D;
+    }
+
+    energy.boots++;
+    energy_saved_lpm3_s = energy.lpm3_s;
+    energy_cycles_mark = Cycles_Now();
+}
+
+void Energy_Save(void)
+{
+    Energy_Update_Active();
+    energy.seq++;
+    energy.checksum = Energy_Checksum(&energy);
+
+    Flash_Erase_Segment(energy_next_seg);
+    Flash_Write_Words(energy_next_seg, (const uint16_t *)&energy, ENERGY_WORDS);
+    energy_next_seg = (energy_next_seg == INFO_D) ? INFO_C : INFO_D;
+    energy_saved_lpm3_s = energy.lpm3_s;
+}
+
+// Chamada uma vez por ciclo do main, antes de hibernar
+void Energy_Service(void)
+{
+    Energy_Update_Active();
+    if (energy.lpm3_s - energy_saved_lpm3_s >= ENERGY_CHECKPOINT_S)
+    {
+        Energy_Save();
+#if DUMP_ENABLE
+        Energy_Dump();
+#endif
+    }
+}
+
+// Soma em active_ms os ciclos acordados desde a última chamada. O contador
+// de 32 bits dá a volta a cada ~68 min acordado (~3 min em CLOCK_FAST), bem
+// mais que um ciclo do main. Clock_Set chama antes de trocar a frequência.
+void Energy_Update_Active(void)
+{
+    uint32_t now = Cycles_Now();
+    uint32_t elapsed = now - energy_cycles_mark;
+    energy.active_ms += elapsed / clock_smclk_per_ms;
+    energy_cycles_mark = now - elapsed % clock_smclk_per_ms;
+}
+
+void Energy_Add_LPM3_ms(uint16_t ms)
+{
+    energy_lpm3_ms += ms;
+    while (energy_lpm3_ms >= 1000)
+    {
+        energy_lpm3_ms -= 1000;
+        energy.lpm3_s++;
+    }
+}
+
+void Energy_Add_Pump_ms(uint16_t ms)
+{
+    energy_pump_ms += ms;
+    while (energy_pump_ms >= 1000)
+    {
+        energy_pump_ms -= 1000;
+        energy.pump_s++;
+    }
+}
+
+#if DUMP_ENABLE
+// Formato texto (UART), no mesmo estilo do perfilamento:
+//   E <boots> <lpm3_s> <active_ms> <wakeups> <pump_s> <lcd> <i2c_bytes>
+void Energy_Dump(void)
+{
+    char line[96];
+    sprintf(line, "E %lu %lu %lu %lu %lu %lu %lu\r\n", (unsigned long)energy.boots,
+            (unsigned long)energy.lpm3_s, (unsigned long)energy.active_ms,
+            (unsigned long)energy.wakeups, (unsigned long)energy.pump_s,
+            (unsigned long)energy.lcd_refreshes, (unsigned long)energy.i2c_bytes);
+    UART_Write(line);
+}
+#endif
+
+// Resumo no LCD: tempo acordado e bomba (s), despertares e reinícios
+void Energy_Show(void)
+{
+    char buffer[64];
+    Energy_Update_Active();
+    sprintf(buffer, "Atv %lus Bb %lus\nDesp %lu R %lu",
+            (unsigned long)(energy.active_ms / 1000), (unsigned long)energy.pump_s,
+            (unsigned long)energy.wakeups, (unsigned long)energy.boots);
+    LCD_Update(buffer);
+}
+
+/*
+ * CALIBRAÇÃO DAS SONDAS
+ */
+
+uint16_t Cal_Checksum(const cal_t *c)
+{
+    const uint16_t *w = (const uint16_t *)c;
+    uint16_t sum = 0;
+    uint8_t i;
+    for (i = 0; i < CAL_SUM_WORDS; i++)
+        sum += w[i];
+    return ~sum;
+}
+
+// Registro íntegro e utilizável: códigos estritamente crescentes dentro da
+// escala e umidades até 100 % em todas as zonas
+bool Cal_Valid(const cal_t *c)
+{
+    uint8_t z, i;
+
+    if (c->magic != CAL_MAGIC || c->checksum != Cal_Checksum(c)) return false;
+    for (z = 0; z < CAL_SLOTS; z++)
+    {
+        for (i = 0; i < CAL_POINTS; i++)
+        {
+            const cal_point_t *pt = &c->point[z][i];
+            if (pt->code > ADC_FULL_SCALE || pt->pct > 100) return false;
+            if (i > 0 && pt->code <= pt[-1].code) return false;
+        }
+    }
+    return true;
+}
+
+// Calibração de dois pontos: os CAL_POINTS pontos da zona ficam igualmente
+// espaçados na reta entre a leitura na água (100 %) e no ar (0 %). Serve
+// para sondas dos dois sentidos (seco = tensão alta ou baixa).
+void Cal_Two_Point(uint8_t z, uint16_t wet, uint16_t dry)
+{
+    uint16_t lo = (wet < dry) ? wet : dry;
+    uint16_t span = ((wet < dry) ? dry : wet) - lo;
+    uint8_t i;
+
+    for (i = 0; i < CAL_POINTS; i++)
+    {
+        uint16_t pct = 100U * i / (CAL_POINTS - 1);
+        cal.point[z][i].code = lo + (uint32_t)span * i / (CAL_POINTS - 1);
+        cal.point[z][i].pct = (wet < dry) ? 100 - pct : pct;
+    }
+}
+
+// Usa a curva gravada no segmento B se for válida; senão a reta padrão
+void Cal_Load(void)
+{
+    const cal_t *stored = (const cal_t *)INFO_B;
+    uint8_t z;
+
+    if (Cal_Valid(stored)) cal = *stored;
+    else
+    {
+        TRACE0("calibração: segmento B inválido, reta padrão");
+        cal.magic = CAL_MAGIC;
+        for (z = 0; z < CAL_SLOTS; z++)
+            Cal_Two_Point(z, CAL_WET_CODE, CAL_DRY_CODE);
+        cal.checksum = Cal_Checksum(&cal);
+    }
+    Cal_Prepare();
+}
+
+// Pré-calcula base e inclinação de cada trecho: as divisões ficam aqui, uma
+// vez por boot. A inclinação é limitada ao int16 do MPY32 (até 0,5 % por
+// código, trechos de pelo menos 2 códigos por ponto percentual).
+void Cal_Prepare(void)
+{
+    uint8_t z, i;
+
+    for (z = 0; z < ZONES; z++)
+    {
+        for (i = 0; i < CAL_POINTS - 1; i++)
+        {
+            const cal_point_t *lo = &cal.point[z][i];
+            int32_t rise = ((int32_t)lo[1].pct - (int32_t)lo->pct) * 65536L;
+            int32_t slope = rise / (int32_t)(lo[1].code - lo->code);
+
+            if (slope > INT16_MAX) slope = INT16_MAX;
+            if (slope < INT16_MIN) slope = INT16_MIN;
+            cal_code[z][i] = lo->code;
+            cal_slope[z][i] = (int16_t)slope;
+            cal_base[z][i] = ((uint32_t)lo->pct << 16) + 0x8000;
+        }
+        cal_code[z][CAL_POINTS - 1] = cal.point[z][CAL_POINTS - 1].code;
+    }
+}
+
+// Umidade da zona z para um código do ADC. Acha o trecho da curva e faz
+// base + inclinação * (código - início) com uma multiplicação-acumulação
+// com sinal do MPY32: RESHI:RESLO recebem a base (Q16, já com o meio ponto
+// do arredondamento), e a parte inteira sai pronta em RESHI. As
+// interrupções ficam desligadas enquanto o multiplicador está em uso.
+// Fora da curva vale o ponto da ponta.
+uint8_t Cal_Percent(uint8_t z, uint16_t code)
+{
+    const uint16_t *edge = cal_code[z];
+    uint8_t s = 0;
+    uint16_t gie;
+    int16_t pct;
+
+    if (code < edge[0]) code = edge[0];
+    if (code > edge[CAL_POINTS - 1]) code = edge[CAL_POINTS - 1];
+    while (s < CAL_POINTS - 2 && code >= edge[s + 1]) s++;
+
+    gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    RESLO = (uint16_t)cal_base[z][s];
+    RESHI = (uint16_t)(cal_base[z][s] >> 16);
+    MACS = cal_slope[z][s];
+    OP2 = code - edge[s];
+    pct = (int16_t)RESHI;
+    if (gie) __enable_interrupt();
+
+    if (pct < 0) return 0;
+    if (pct > 100) return 100;
+    return (uint8_t)pct;
+}
+
+// Código do ADC em que a curva da zona z passa pela umidade pct (o inverso
+// de Cal_Percent), no primeiro trecho que a contém; fora da curva vale a
+// ponta de umidade mais próxima. Tem uma divisão: só arma a vigília.
+uint16_t Cal_Code(uint8_t z, uint8_t pct)
+{
+    const cal_point_t *pt = cal.point[z];
+    int16_t first, last;
+    uint8_t i;
+
+    for (i = 0; i < CAL_POINTS - 1; i++)
+    {
+        int16_t a = pt[i].pct, b = pt[i + 1].pct;
+        if ((pct >= a && pct <= b) || (pct <= a && pct >= b))
+        {
+            if (a == b) return pt[i].code;
+            return pt[i].code + (int32_t)(pct - a) *
+                   (int32_t)(pt[i + 1].code - pt[i].code) / (b - a);
+        }
+    }
+    first = (int16_t)pct - (int16_t)pt[0].pct;
+    last = (int16_t)pct - (int16_t)pt[CAL_POINTS - 1].pct;
+    if (first < 0) first = -first;
+    if (last < 0) last = -last;
+    return (first <= last) ? pt[0].code : pt[CAL_POINTS - 1].code;
+}
+
+/*
+ * VIGÍLIA DO LIMIAR (COMPARATOR_B)
+ */
+
+// Arma a vigília se nenhuma zona está seca ou regando e a próxima leitura
+// viria antes de SAMPLE_MAX_S: calcula a derivação de cada zona e agenda o
+// primeiro pulso interval_s depois do prazo desta leitura. A derivação fica
+// do lado úmido do limiar (n + 1 = código / 128, para baixo), então o
+// comparador nunca deixa passar uma zona seca. Sondas com tensão baixa =
+// seco (curva crescente) ficam sem vigília.
+bool Comp_Watch_Start(uint16_t interval_s)
+{
+    uint8_t z;
+
+    comp_interval_s = 0;
+    Sched_Cancel(TASK_WATCH);
+    if (interval_s >= SAMPLE_MAX_S) return false;
+
+    for (z = 0; z < ZONES; z++)
+    {
+        const cal_point_t *pt = cal.point[z];
+        if (zones[z].dry_streak || zones[z].pump_state != PUMP_IDLE) return false;
+        if (pt[0].pct < pt[CAL_POINTS - 1].pct) return false;
+    }
+
+    for (z = 0; z < ZONES; z++)
+    {
+        uint32_t code = Cal_Code(z, zone_cfg[z].threshold);
+#if ADC_USE_REF
+        // O código é em volts absolutos e a escada é sobre Vcc
+        code = code * ADC_REF_MV / supply_mv;
+#endif
+        uint16_t steps = code >> 7;
+        comp_tap[z] = steps > 32 ? 31 : (steps ? steps - 1 : 0);
+    }
+
+    comp_interval_s = interval_s;
+    Sched_At(TASK_WATCH, sched_deadline[TASK_SENSE] + ((uint32_t)interval_s << 15));
+    return true;
+}
+
+// Pulso de vigília: liga a sonda, espera ela estabilizar em LPM3 com o
+// comparador desligado e então passa pelas zonas. Em cada uma a derivação
+// começa no topo (saída em 0) e desce até a da zona: uma zona mais seca que
+// ela dá a borda de subida que interrompe. Com cruzamento, a leitura
+// completa é antecipada para agora (o intervalo dela vira o tempo desde a
+// anterior, em segundos inteiros) e a vigília para até ela decidir de novo.
+// Sem cruzamento, o próximo pulso vem comp_interval_s depois, se ainda
+// couber antes da leitura completa.
+void Task_Watch(void)
+{
+    uint32_t last, next;
+    uint8_t z;
+
+    comp_crossed = false;
+    P6OUT |= SENSOR_PWR_PIN;
+    Enter_Assistive_Wait_ms(SENSOR_SETTLE_MS);
+
+    CBCTL1 |= CBON;
+    for (z = 0; z < ZONES && !comp_crossed; z++)
+    {
+        CBINT = 0;
+        CBCTL0 = CBIPEN | zone_cfg[z].inch;
+        CBCTL2 = CBRSEL | CBRS_1 | CBREF0_31 | CBREF1_31;
+        Delay_us_Custom(COMP_SETTLE_US);
+
+        CBINT = CBIE;  // CBIFG limpo; borda de subida (CBIES = 0)
+        CBCTL2 = CBRSEL | CBRS_1 | comp_tap[z] | ((uint16_t)comp_tap[z] << 8);
+        Delay_us_Custom(COMP_SETTLE_US);
+    }
+    CBINT = 0;
+    CBCTL1 &= ~CBON;
+
+    // Com cruzamento a sonda segue ligada para a leitura de confirmação
+    if (comp_crossed)
+    {
+        last = sched_deadline[TASK_SENSE] - ((uint32_t)sample_interval_s << 15);
+        sample_interval_s = (uint16_t)((Sched_Now() - last) >> 15);
+        Sched_At(TASK_SENSE, last + ((uint32_t)sample_interval_s << 15));
+        comp_interval_s = 0;
+        TRACE("vigília: limiar cruzado, leitura antecipada para %u s", sample_interval_s);
+        return;
+    }
+    P6OUT &= ~SENSOR_PWR_PIN;
+
+    next = sched_deadline[TASK_WATCH] + ((uint32_t)comp_interval_s << 15);
+    if ((int32_t)(sched_deadline[TASK_SENSE] - next) > 0) Sched_At(TASK_WATCH, next);
+}
+
+// --- INTERRUPÇÃO DO COMPARATOR_B ---
+// Zona acima da derivação: marca o cruzamento e para de interromper
+#pragma vector=COMP_B_VECTOR
+__interrupt void COMP_B_ISR(void)
+{
+    switch (__even_in_range(CBIV, 4))
+    {
+    case 2: // CBIFG
+        CBINT &= ~CBIE;
+        comp_crossed = true;
+        __bic_SR_register_on_exit(LPM3_bits);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * ALIMENTAÇÃO
+ */
+
+// Conversão avulsa de (AVCC - AVSS) / 2 na posição ADC_SUPPLY_SLOT, com o
+// ADC desligado antes e depois. A configuração da sequência das zonas é
+// guardada e devolvida.
+uint16_t Supply_Read_mV(void)
+{
+    uint16_t ctl0 = ADC12CTL0, ctl1 = ADC12CTL1;
+    uint16_t mctl = (&ADC12MCTL0)[ADC_SUPPLY_SLOT], ie = ADC12IE;
+    uint16_t code;
+
+    // Divisor interno de alta impedância: 32 ciclos de amostragem
+    ADC12CTL0 = (ctl0 & ~ADC12SHT1_15) | ADC12SHT1_3;
+    ADC12CTL1 = (ctl1 & ~ADC12CONSEQ_3) | ADC12CSTARTADD_15 | ADC12CONSEQ_0;
+    (&ADC12MCTL0)[ADC_SUPPLY_SLOT] = ADC12SREF_1 | ADC12INCH_11 | ADC12EOS;
+    ADC12IE = 1U << ADC_SUPPLY_SLOT;
+
+    REFCTL0 = (REFCTL0 & ~REFVSEL_3) | REFMSTR | REFVSEL_1 | REFON;
+    Delay_us_Custom(ADC_REF_SETTLE_US);
+    ADC12CTL0 |= ADC12ON;
+    ADC12CTL0 |= ADC12ENC;
+    ADC_Run();
+    code = (&ADC12MEM0)[ADC_SUPPLY_SLOT];
+
+    ADC12CTL0 &= ~ADC12ENC;
+    ADC12CTL0 = ctl0;
+    ADC12CTL1 = ctl1;
+    (&ADC12MCTL0)[ADC_SUPPLY_SLOT] = mctl;
+    ADC12IE = ie;
+    REFCTL0 &= ~REFON;
+
+    // AVCC = 2 x código x 2000 mV / 4096
+    return (uint16_t)((uint32_t)code * 125 / 128);
+}
+
+// Mede e reescolhe o nível. Na troca, aplica o que não espera a próxima
+// leitura (luz de fundo, tela) e registra no log.
+void Supply_Check(void)
+{
+    uint8_t tier = 0;
+
+    supply_mv = Supply_Read_mV();
+    while (tier + 1 < SUPPLY_TIERS &&
+           supply_mv < supply_tiers[tier].min_mv + (tier < supply_tier ? SUPPLY_HYST_MV : 0))
+        tier++;
+    if (tier == supply_tier) return;
+
+    supply_tier = tier;
+    if (!supply_tiers[tier].backlight && lcd_backlight != BL_OFF)
+    {
+        Sched_Cancel(TASK_BACKLIGHT);
+        LCD_Backlight(BL_OFF);
+    }
+    Sched_Post(TASK_DISPLAY);
+    TRACE("alimentação: %u mV, nível %u", supply_mv, tier);
+}
+
+// Intervalo de amostragem esticado pelo nível da alimentação
+uint16_t Supply_Interval(uint16_t interval_s)
+{
+    return interval_s * supply_tiers[supply_tier].interval_x;
+}
+
+/*
+ * GRAVAÇÃO NA FLASH
+ */
+
+// Apaga um segmento (128 bytes na memória de informação, 512 na principal).
+// A CPU fica parada enquanto o controlador de flash trabalha (~25 ms).
+void Flash_Erase_Segment(uint8_t *segment)
+{
+    __disable_interrupt();
+    FCTL3 = FWKEY;                 // Destrava (LOCK = 0)
+    FCTL1 = FWKEY | ERASE;         // Apagamento de segmento
+    FLASH_DUMMY_WRITE(segment);    // Escrita fictícia dispara o apagamento
+    while (FCTL3 & BUSY);
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY | LOCK;
+    __enable_interrupt();
+}
+
+// Grava 'words' palavras numa área já apagada (~64 us por palavra)
+void Flash_Write_Words(uint8_t *dst, const uint16_t *data, uint8_t words)
+{
+    volatile uint16_t *w = (volatile uint16_t *)dst;
+    uint8_t i;
+
+    __disable_interrupt();
+    FCTL3 = FWKEY;
+    FCTL1 = FWKEY | WRT;           // Gravação palavra a palavra
+    for (i = 0; i < words; i++)
+    {
+        w[i] = data[i];
+        while (FCTL3 & BUSY);
+    }
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY | LOCK;
+    __enable_interrupt();
+}
+
+/*
+ * LOG PERSISTENTE
+ */
+
+// Segmentos apagados (0xFFFF) e zerados (firmware recém-gravado) não passam
+uint16_t Log_Checksum(const volatile log_record_t *r)
+{
+    const volatile uint16_t *w = (const volatile uint16_t *)r;
+    return (uint16_t)~(w[0] + w[1] + w[2]);
+}
+
+// A posição guarda um registro válido da volta do anel que começa em 'base'
+bool Log_In_Lap(uint16_t pos, uint16_t base)
+{
+    const volatile log_record_t *r = LOG_RECORD(pos);
+    return r->checksum == Log_Checksum(r) && r->seq == (uint16_t)(base + pos);
+}
+
+bool Log_Blank(uint16_t pos)
+{
+    const volatile uint16_t *w = (const volatile uint16_t *)LOG_RECORD(pos);
+    uint8_t i;
+    for (i = 0; i < LOG_RECORD_WORDS; i++)
+        if (w[i] != 0xFFFF) return false;
+    return true;
+}
+
+// Acha o registro mais recente com ~11 leituras em vez de varrer o anel,
+// em duas buscas: o segmento e a posição dentro dele. Todo segmento é
+// apagado e gravado a partir da primeira posição, então da âncora até o
+// segmento atual a primeira posição é da volta corrente e depois dele vêm
+// segmentos apagados ou da volta anterior (sequência LOG_CAPACITY menor).
+// Dentro do segmento atual os registros válidos formam um prefixo, porque
+// o log nunca retoma depois de uma posição suja. Assim Log_In_Lap é
+// monotônico nas duas buscas, mesmo com gravações interrompidas no anel.
+void Log_Recover(void)
+{
+    uint16_t anchor = 0, base, lo, hi, mid, n, count;
+
+    // O segmento 0 pode ter sido apagado logo antes de um reset; nesse caso
+    // a volta anterior, a partir do segmento 1, é a mais recente
+    if (!Log_In_Lap(0, LOG_RECORD(0)->seq)) anchor = LOG_PER_SEGMENT;
+    base = LOG_RECORD(anchor)->seq - anchor;
+    if (!Log_In_Lap(anchor, base)) return;  // Log vazio
+
+    lo = anchor / LOG_PER_SEGMENT;
+    hi = LOG_SEGMENTS - 1;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (Log_In_Lap(mid * LOG_PER_SEGMENT, base)) lo = mid;
+        else hi = mid - 1;
+    }
+
+    lo *= LOG_PER_SEGMENT;
+    hi = lo + LOG_PER_SEGMENT - 1;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (Log_In_Lap(mid, base)) lo = mid;
+        else hi = mid - 1;
+    }
+    log_seq = base + lo + 1;
+
+    // Até LOG_REPLAY_MAX registros consecutivos terminando no mais recente
+    // voltam para o histórico com os intervalos gravados. Os mais antigos
+    // que a janela só avançam o relógio e o arquivo: History_Insert
+    // descartaria logo depois tudo o que fizesse com eles.
+    for (n = 1; n < LOG_REPLAY_MAX; n++)
+    {
+        uint16_t pos = (uint16_t)(lo - n) % LOG_CAPACITY;
+        if (!Log_In_Lap(pos, log_seq - 1 - n - pos)) break;
+    }
+
+    TRACE("log: %u leituras refazem o histórico", n);
+    uint32_t prev = 0;
+    for (count = n; n--; )
+    {
+        const volatile log_record_t *r = LOG_RECORD((uint16_t)(log_seq - 1 - n) % LOG_CAPACITY);
+        uint32_t minute = r->minute_lo | (uint32_t)r->minute_hi << 16;
+        uint32_t dt = n + 1 < count ? (minute - prev) * 60 : 0;
+        uint8_t value = r->value & ~LOG_BOOT_FLAG;
+        if (dt > 0xFFFF) dt = 0xFFFF;
+        if (n < HISTORY_SIZE) History_Insert(value, (uint16_t)dt);
+        else
+        {
+            history_clock_s += dt;
+            Archive_Insert(value);
+        }
+        prev = minute;
+    }
+    log_minute_base = prev - history_clock_s / 60;
+
+    // Uma gravação interrompida deixa a posição seguinte suja. O resto do
+    // segmento fica sem uso e o log retoma no próximo, que será apagado
+    // antes de gravar: pular só até a próxima posição limpa deixaria um
+    // buraco no meio da volta e a busca pararia nele nos boots seguintes
+    if (log_seq % LOG_PER_SEGMENT && !Log_Blank(log_seq % LOG_CAPACITY))
+        log_seq = (log_seq | (LOG_PER_SEGMENT - 1)) + 1;
+}
+
+// Grava a leitura com o relógio do log. O tempo desligado não é conhecido:
+// depois de um reset o relógio continua do último registro, marcado com
+// LOG_BOOT_FLAG.
+void Log_Append(uint8_t value)
+{
+    uint16_t pos = log_seq % LOG_CAPACITY;
+    uint32_t minute = log_minute_base + history_clock_s / 60;
+    log_record_t r;
+
+    // Entrando num segmento: apaga-o agora, uma vez por volta do anel
+    if (pos % LOG_PER_SEGMENT == 0) Flash_Erase_Segment((uint8_t *)LOG_RECORD(pos));
+
+    r.seq = log_seq;
+    r.minute_lo = (uint16_t)minute;
+    r.minute_hi = (uint8_t)(minute >> 16);
+    r.value = value | (log_booted ? 0 : LOG_BOOT_FLAG);
+    r.checksum = Log_Checksum(&r);
+    Flash_Write_Words((uint8_t *)LOG_RECORD(pos), (const uint16_t *)&r, LOG_RECORD_WORDS);
+
+    log_seq++;
+    log_booted = true;
+}
+
+/*
+ * DRIVER LCD I2C
+ */
+
+void LCD_Init_I2C_RegisterLevel(void)
+{
+    UCB0CTL1 |= UCSWRST;
+    P3SEL |= BIT0 | BIT1; 
+    P3REN |= BIT0 | BIT1;
+    P3OUT |= BIT0 | BIT1;
+
+    UCB0CTL0 = UCMST | UCMODE_3 | UCSYNC;
+    UCB0CTL1 = UCSSEL__SMCLK | UCTR | UCSWRST; // SMCLK do perfil atual
+    I2C_Set_Rate();
+}
+
+// SCL em ~I2C_BUS_HZ a partir do SMCLK atual. O divisor só muda com o módulo
+// em reset, que zera o UCB0IE: I2C_Start_Frame o liga de novo a cada quadro.
+void I2C_Set_Rate(void)
+{
+    uint16_t br = clock_smclk_hz / I2C_BUS_HZ;
+
+    UCB0CTL1 |= UCSWRST;
+    UCB0BR0 = br & 0xFF;
+    UCB0BR1 = br >> 8;
+    UCB0CTL1 &= ~UCSWRST;
+}
+
+RAMFUNC void I2C_Send(uint8_t addr, uint8_t data)
+{
+    // Mantém a semântica original: uma transação (START/endereço/dado/STOP)
+    // por byte, mas agora apenas enfileirada. Quem envia não espera o barramento.
+    I2C_Queue_Frame(addr, &data, 1);
+}
+
+RAMFUNC uint8_t I2C_Queue_Free(void)
+{
+    // Uma posição fica sempre vazia para distinguir fila cheia de vazia
+    return (uint8_t)((i2c_tail - i2c_head - 1) & I2C_QUEUE_MASK);
+}
+
+RAMFUNC void I2C_Queue_Frame(uint8_t addr, const uint8_t *data, uint8_t len)
+{
+    // Fila cheia: dorme em LPM0 até a ISR liberar espaço
+    while (I2C_Queue_Free() < (uint8_t)(len + 2))
+    {
+        __disable_interrupt();
+        I2C_Kick();
+        if (I2C_Queue_Free() < (uint8_t)(len + 2))
+        {
+            i2c_waiting = true;
+            __bis_SR_register(LPM0_bits + GIE);
+            energy.wakeups++;
+        }
+        __enable_interrupt();
+    }
+
+    energy.i2c_bytes += len + 1;  // Endereço + dados
+
+    // Apenas o main escreve em i2c_head, então não precisa de seção crítica aqui
+    uint8_t head = i2c_head;
+    i2c_queue[head] = addr;
+    head = (head + 1) & I2C_QUEUE_MASK;
+    i2c_queue[head] = len;
+    head = (head + 1) & I2C_QUEUE_MASK;
+    while (len--)
+    {
+        i2c_queue[head] = *data++;
+        head = (head + 1) & I2C_QUEUE_MASK;
+    }
+    i2c_head = head;
+
+    __disable_interrupt();
+    I2C_Kick();
+    __enable_interrupt();
+}
+
+// Carrega o próximo quadro da fila e gera (re)START.
+// Chamada pela ISR ou pelo main com interrupções desabilitadas.
+RAMFUNC void I2C_Start_Frame(void)
+{
+    UCB0I2CSA = i2c_queue[i2c_tail];
+    i2c_tail = (i2c_tail + 1) & I2C_QUEUE_MASK;
+    i2c_frame_left = i2c_queue[i2c_tail];
+    i2c_tail = (i2c_tail + 1) & I2C_QUEUE_MASK;
+    UCB0CTL1 |= UCTR | UCTXSTT;
+}
+
+// Inicia a transmissão se o barramento estiver parado e houver dados.
+// Deve ser chamada com interrupções desabilitadas.
+RAMFUNC void I2C_Kick(void)
+{
+    if (!i2c_idle || i2c_head == i2c_tail) return;
+
+    // O STOP do último quadro pode ainda estar sendo gerado (no máximo ~1 byte)
+    while (UCB0CTL1 & UCTXSTP);
+
+    i2c_idle = false;
+    I2C_Start_Frame();
+    UCB0IE |= UCTXIE | UCNACKIE;
+}
+
+// Espera em LPM0 (CPU desligada, SMCLK ligado) até a fila esvaziar
+void I2C_Wait_Idle(void)
+{
+    __disable_interrupt();
+    I2C_Kick();
+    while (!i2c_idle)
+    {
+        __bis_SR_register(LPM0_bits + GIE);
+        energy.wakeups++;
+        __disable_interrupt();
+    }
+    __enable_interrupt();
+
+    while (UCB0CTL1 & UCTXSTP);
+}
+
+// --- INTERRUPÇÃO DO USCI_B0 (I2C) ---
+// Alimenta o TXBUF a partir da fila; a CPU só acorda para isso.
+#pragma vector=USCI_B0_VECTOR
+RAMFUNC __interrupt void USCI_B0_ISR(void)
+{
+    switch (__even_in_range(UCB0IV, 12))
+    {
+    case 4: // UCNACKIFG: escravo não respondeu, descarta o resto do quadro
+        i2c_tail = (i2c_tail + i2c_frame_left) & I2C_QUEUE_MASK;
+        i2c_frame_left = 0;
+        if (i2c_head != i2c_tail)
+        {
+            I2C_Start_Frame(); // START repetido para o próximo quadro
+            break;
+        }
+        UCB0CTL1 |= UCTXSTP;
+        UCB0IFG &= ~UCTXIFG;
+        UCB0IE &= ~(UCTXIE | UCNACKIE);
+        i2c_idle = true;
+        __bic_SR_register_on_exit(LPM0_bits);
+        break;
+
+    case 12: // UCTXIFG: TXBUF livre
+        if (i2c_frame_left)
+        {
+            UCB0TXBUF = i2c_queue[i2c_tail];
+            i2c_tail = (i2c_tail + 1) & I2C_QUEUE_MASK;
+            i2c_frame_left--;
+        }
+        else if (i2c_head != i2c_tail)
+        {
+            // Fim do quadro com mais dados na fila: START repetido.
+            // O UCTXIFG é limpo para só voltar após o novo endereço.
+            UCB0IFG &= ~UCTXIFG;
+            I2C_Start_Frame();
+        }
+        else
+        {
+            // Fila vazia: STOP após o último byte e sinaliza conclusão
+            UCB0CTL1 |= UCTXSTP;
+            UCB0IFG &= ~UCTXIFG;
+            UCB0IE &= ~(UCTXIE | UCNACKIE);
+            i2c_idle = true;
+                __bic_SR_register_on_exit(LPM0_bits);
+        }
+
+        if (i2c_waiting)
+        {
+            i2c_waiting = false;
+            __bic_SR_register_on_exit(LPM0_bits);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Espera de pelo menos time_us em LPM3, com resolução de um ciclo de ACLK
+// (30,5 µs): arredonda para cima e soma um ciclo pela fase do contador
+void Delay_us_Custom(unsigned int time_us)
+{
+    uint32_t ticks = ((uint32_t)time_us * 32768UL + 999999UL) / 1000000UL + 1;
+
+    Vtimer_Wait(VTIMER_DELAY, ticks);
+    Energy_Add_LPM3_ms(time_us / 1000);
+}
+
+// Codifica um nibble no buffer de rajada.
+// O byte de preparação (EN baixo) só é necessário quando RS ou backlight
+// mudam, pois RS precisa estabilizar antes da subida do EN. Os dados podem
+// mudar junto com a subida do EN: o LCD só os amostra na descida.
+RAMFUNC void LCD_Burst_Nibble(uint8_t nibble, uint8_t isChar)
+{
+    uint8_t i2cValue = (nibble & 0xF0) | (lcd_backlight != BL_OFF ? BL_BIT : 0);
+    if (isChar) i2cValue |= RS_BIT;
+    else i2cValue &= ~RS_BIT;
+
+    i2cValue &= ~(RW_BIT | EN_BIT);
+
+    if (lcd_burst_len > LCD_BURST_MAX - 3) LCD_Burst_Flush();
+
+    if ((i2cValue ^ lcd_bus) & (RS_BIT | BL_BIT))
+        lcd_burst[lcd_burst_len++] = i2cValue;
+    lcd_burst[lcd_burst_len++] = i2cValue | EN_BIT;
+    lcd_burst[lcd_burst_len++] = i2cValue;  // Descida do EN: LCD trava D7..D4
+
+    // Cada byte a 100 kHz dura 90 us, mais que o pulso de EN (450 ns) e o
+    // tempo de execução do LCD (37 us), então não há atrasos explícitos.
+    lcd_bus = i2cValue;
+}
+
+void LCD_Burst_Byte(uint8_t byte, uint8_t isChar)
+{
+    LCD_Burst_Nibble(byte, isChar);
+    LCD_Burst_Nibble(byte << 4, isChar);
+}
+
+// Envia o que foi codificado como uma única transação I2C
+void LCD_Burst_Flush(void)
+{
+    if (lcd_burst_len == 0) return;
+    I2C_Queue_Frame(LCD_ADDR, lcd_burst, lcd_burst_len);
+    lcd_burst_len = 0;
+}
+
+void LCD_Write_Nibble(uint8_t nibble, uint8_t isChar)
+{
+    LCD_Burst_Nibble(nibble, isChar);
+    LCD_Burst_Flush();
+}
+
+void LCD_Write_Byte(uint8_t byte, uint8_t isChar)
+{
+    LCD_Burst_Byte(byte, isChar);
+    LCD_Burst_Flush();
+}
+
+// Muda a luz de fundo sem tocar no LCD: um byte com EN baixo e RS como
+// estava. Os bytes seguintes de LCD_Burst_Nibble mantêm o novo estado.
+void LCD_Backlight(uint8_t state)
+{
+    uint8_t v;
+
+#ifdef BL_DIM_ENABLE
+    if (state == BL_DIM)
+    {
+        TA0CCR0 = BL_PWM_PERIOD - 1;
+        TA0CCR1 = BL_PWM_PERIOD * BL_DIM_PCT / 100;
+        TA0CCTL1 = OUTMOD_7;  // Reset/Set
+        TA0CTL = TASSEL__ACLK | MC__UP | TACLR;
+        P1SEL |= BL_GATE_PIN;
+    }
+    else
+    {
+        // Porta sempre aberta e TA0 parado
+        P1SEL &= ~BL_GATE_PIN;
+        TA0CTL = MC_0;
+    }
+#endif
+
+    lcd_backlight = state;
+    v = (lcd_bus & ~BL_BIT) | (state != BL_OFF ? BL_BIT : 0);
+    if (v == lcd_bus) return;
+    lcd_bus = v;
+    I2C_Queue_Frame(LCD_ADDR, &v, 1);
+}
+
+void LCD_Init(void)
+{
+    // Os atrasos só contam depois que a fila I2C foi realmente enviada
     Delay_us_Custom(20000);
-    LCD_Write_Nibble(0x30, 0); Delay_us_Custom(5000);
-    LCD_Write_Nibble(0x30, 0); Delay_us_Custom(100);
-    LCD_Write_Nibble(0x30, 0); Delay_us_Custom(100);
-    LCD_Write_Nibble(0x20, 0); Delay_us_Custom(100);
+    LCD_Write_Nibble(0x30, 0); I2C_Wait_Idle(); Delay_us_Custom(5000);
+    LCD_Write_Nibble(0x30, 0); I2C_Wait_Idle(); Delay_us_Custom(100);
+    LCD_Write_Nibble(0x30, 0); I2C_Wait_Idle(); Delay_us_Custom(100);
+    LCD_Write_Nibble(0x20, 0); I2C_Wait_Idle(); Delay_us_Custom(100);
 
     LCD_Write_Byte(CMD_FUNCTION_SET, 0);
     LCD_Write_Byte(CMD_DISPLAY_CONTROL, 0);
     LCD_Write_Byte(CMD_ENTRY_MODE_SET, 0);
     LCD_Write_Byte(CMD_CLEAR_DISPLAY, 0);
+    I2C_Wait_Idle();
     Delay_us_Custom(2000);
     LCD_Write_Byte(CMD_RETURN_HOME, 0);
+    I2C_Wait_Idle();
+    Delay_us_Custom(2000);
+
+    // Display limpo: o espelho começa todo em branco com o cursor na origem
+    uint8_t row, col;
+    for (row = 0; row < LCD_ROWS; row++)
+        for (col = 0; col < LCD_COLS; col++)
+            lcd_shadow[row][col] = ' ';
+    lcd_cursor = 0;
 }
 
+// Atualiza o display comparando com o espelho: só as células alteradas são
+// enviadas, com saltos de cursor entre elas. Sem CMD_CLEAR_DISPLAY (e sem
+// os 2 ms de espera) no caminho normal, o que também elimina o piscar.
 void LCD_Update(char *str)
 {
-    LCD_Write_Byte(CMD_CLEAR_DISPLAY, 0);
-    Delay_us_Custom(2000);
-    while (*str)
+    char frame[LCD_ROWS][LCD_COLS];
+    uint8_t row = 0, col = 0;
+
+    energy.lcd_refreshes++;
+
+    // Monta o quadro desejado, completando com espaços
+    for (row = 0; row < LCD_ROWS; row++)
+        for (col = 0; col < LCD_COLS; col++)
+            frame[row][col] = ' ';
+
+    row = 0;
+    col = 0;
+    while (*str && row < LCD_ROWS)
     {
-        if (*str == '\n') LCD_Write_Byte(CMD_SECOND_LINE, 0);
-        else LCD_Write_Byte(*str, 1);
+        if (*str == '\n') { row++; col = 0; }
+        else if (col < LCD_COLS) frame[row][col++] = *str;
         str++;
     }
-}
 
+    for (row = 0; row < LCD_ROWS; row++)
+    {
+        uint8_t base = row ? 0x40 : 0x00;
+        for (col = 0; col < LCD_COLS; col++)
+        {
+            if (frame[row][col] == lcd_shadow[row][col]) continue;
+
+            uint8_t addr = base + col;
+            uint8_t gap = addr - lcd_cursor;
+
+            // Salto curto na mesma linha: reescrever as células iguais sai
+            // mais barato que o comando de posicionamento
+            if (lcd_cursor < addr && lcd_cursor >= base && gap <= LCD_MAX_GAP)
+            {
+                while (lcd_cursor < addr)
+                {
+                    LCD_Burst_Byte(frame[row][lcd_cursor - base], 1);
+                    lcd_cursor++;
+                }
+            }
+            else if (lcd_cursor != addr)
+            {
+                LCD_Burst_Byte(CMD_SET_DDRAM | addr, 0);
+            }
+
+            LCD_Burst_Byte(frame[row][col], 1);
+            lcd_shadow[row][col] = frame[row][col];
+            lcd_cursor = addr + 1;
+        }
+    }
 
+    // O restante apenas é enfileirado; a ISR envia enquanto o main segue
+    LCD_Burst_Flush();
+}
@@ -0,0 +1,485 @@
+/*
+ * BENCHMARK DE ENERGIA POR CENÁRIO
+ *
+ * Roda o ProjetoFinal.c sobre o modelo de registradores (sim.c) contra
+ * cenários de umidade do solo em dias simulados e imprime uma linha JSON
+ * por cenário, para que execuções com configurações diferentes possam ser
+ * comparadas com diff.
+ *
+ * Uso: ./bench [-d dias] [-s cenário] [-u arquivo_uart] [-r semente]
+ *              [-f arquivo_info] [-b toques_por_dia] [-k curvatura] [-c]
+ *              [-v volts_início:volts_fim]
+ *
+ * Com -f a memória de informação é lida do arquivo (se existir) e gravada
+ * de volta no fim, simulando um reset entre execuções; use junto com -s.
+ *
+ * Alguém olha o display -b vezes por dia (4 por padrão), alternando os
+ * botões S1 (P2.1) e S2 (P1.1), em horários espaçados igualmente.
+ *
+ * -k entorta a resposta da sonda: tensão = AVCC x (1 - umidade)^k (1 por
+ * padrão, a reta que o firmware assume sem calibração). -c grava no
+ * segmento B a curva de calibração que um técnico levantaria para essa
+ * sonda, no formato lido por Cal_Load().
+ *
+ * Sem -v a alimentação é fixa em AVCC_V. Com -v ela é uma bateria que cai
+ * em linha reta de volts_início a volts_fim ao longo dos dias simulados e
+ * afunda BATT_SAG_V com uma bomba a pleno (resistência interna). O
+ * relatório traz a menor tensão e o tempo abaixo de BROWNOUT_V.
+ *
+ * As correntes abaixo são estimativas de datasheet (MSP430F5529, módulo
+ * LCD 1602 com backpack PCF8574, sonda resistiva e mini bomba de 5 V) e
+ * servem para comparar configurações, não para prever a autonomia exata.
+ * O tempo de CPU é estimado pelos acessos a registradores e pelas entradas
+ * em ISR; código C puro (sprintf, laços de cálculo) roda no PC sem custo
+ * simulado, então active_ms é um limite inferior.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "msp430.h"
+#include "sim.h"
+
+void firmware_main(void);  // main() do ProjetoFinal.c (-Dmain=firmware_main)
+
+/* * CORRENTES ESTIMADAS (mA) * */
+#define I_ACTIVE          0.06   // Parte fixa do modo ativo
+#define I_LPM0            0.060  // LPM0 sem o DCO
+#define I_LPM0_PER_MHZ    0.020  // DCO/FLL ligados em LPM0
+#define I_LPM3            0.0021 // LPM3 com o XT1
+#define I_REFO            0.003  // REFO ligado (sem o XT1, ou referência do FLL)
+#define I_ADC             0.20
+#define I_REF             0.10
+#define I_COMP            0.04   // Comparator_B em CBPWRMD_1, com a escada
+#define I_I2C_BUSY        0.35   // Pull-ups de 4k7 com o barramento ativo
+#define I_UART_BUSY       0.05
+#define I_FLASH           3.0    // Apagamento/gravação da flash
+#define I_SENSOR          3.0
+#define I_PUMP            180.0
+#define I_LCD_LOGIC       1.2    // HD44780 + PCF8574, sempre alimentados
+#define I_BACKLIGHT       20.0
+
+// mA por MHz de MCLK em cada nível de PMMCOREV (flash, 3 V)
+static const double I_ACTIVE_PER_MHZ[4] = { 0.23, 0.24, 0.25, 0.26 };
+// O mesmo executando da RAM (IAM,RAM: pouco mais da metade, sem a flash)
+static const double I_ACTIVE_RAM_PER_MHZ[4] = { 0.13, 0.135, 0.14, 0.145 };
+
+/* * MODELO DO SOLO * */
+#define SENSOR_TAU_S      0.010  // Constante de tempo da sonda ao ligar
+#define PUMP_GAIN_PCT_S   1.5    // Umidade adicionada por segundo de bomba
+#define WATER_TAU_H       36.0   // Drenagem da água irrigada
+#define NOISE_V           0.010  // Ruído gaussiano na leitura
+#define SPIKE_PROB        0.02   // Probabilidade de um pico espúrio por amostra
+#define SPIKE_V           0.5
+#define AVCC_V            3.3
+#define ZONE_LAG_H        5.0    // Cada canteiro seca com este atraso em relação ao anterior
+
+/* * BATERIA (-v) * */
+#define BATT_SAG_V        0.30   // Queda com uma bomba a pleno
+#define BROWNOUT_V        2.20   // Abaixo disso o LCD e o MSP430 não se garantem
+
+/* * REGISTRO DE CALIBRAÇÃO (cal_t do ProjetoFinal.c) * */
+#define CAL_OFFSET        256    // Segmento B
+#define CAL_POINTS        5
+#define CAL_SLOTS         4
+#define CAL_MAGIC         0xCA1B
+
+/* * BOTÕES E LUZ DE FUNDO * */
+#define PRESS_PS          (150 * SIM_PS_PER_S / 1000)  // Duração de cada toque
+#define BL_GATE_PIN       BIT2   // P1.2: porta de habilitação em série com o P3 do PCF8574
+
+// Canteiros como ligados pelo ProjetoFinal.c (zone_cfg): entrada analógica,
+// bomba em P2 e se ela é a saída TA1.1. Zonas que o firmware não usa ficam
+// com a bomba desligada (P2DIR em 0) e não entram no relatório.
+typedef struct
+{
+    int inch;
+    uint16_t pump_pin;
+    int pwm;
+} zone_t;
+
+static const zone_t zones[] = {
+    { 0, BIT0, 1 },
+    { 2, BIT2, 0 },
+    { 3, BIT3, 0 },
+    { 4, BIT4, 0 },
+};
+#define NZONES (int)(sizeof(zones) / sizeof(zones[0]))
+
+typedef struct
+{
+    const char *name;
+    double (*base)(double hours);  // Umidade (%) sem irrigação
+} scenario_t;
+
+static double dry_spell(double h)
+{
+    double m = 45.0 - 0.8 * h;
+    return m < 5.0 ? 5.0 : m;
+}
+
+static double steady_wet(double h)
+{
+    return 75.0 + 2.0 * sin(2.0 * M_PI * h / 24.0);
+}
+
+static double oscillating(double h)
+{
+    return 30.0 + 4.0 * sin(2.0 * M_PI * h / 7.0);
+}
+
+static const scenario_t scenarios[] = {
+    { "dry_spell",   dry_spell },
+    { "steady_wet",  steady_wet },
+    { "oscillating", oscillating },
+};
+#define NSCENARIOS (int)(sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const scenario_t *scenario;
+static int days = 7;
+static const char *info_path = 0;
+static uint64_t rng = 1;
+
+static double water[NZONES];        // Água irrigada ainda no solo (%)
+static uint64_t sensor_on_ps = 0;   // Há quanto tempo a sonda está ligada
+static uint64_t sensor_total_ps = 0;
+static uint64_t pump_ps = 0;        // Bomba acionada (qualquer ciclo de trabalho)
+static double pump_full_ps = 0;     // Idem, ponderado pelo ciclo de trabalho
+static uint32_t pump_starts = 0;
+static double pump_duty_last[NZONES];
+static double pump_max_step = 0;    // Maior degrau de ciclo de trabalho (corrente de partida)
+static double pump_peak = 0;        // Maior soma dos ciclos de trabalho (bombas a pleno)
+static double backlight_ps = 0;     // Luz de fundo, ponderada pelo brilho
+static int presses_per_day = 4;
+static uint32_t presses = 0;        // Toques já completos
+static int press_down = 0;
+static double probe_k = 1.0;        // Curvatura da sonda (-k)
+static int probe_cal = 0;           // Grava a calibração da sonda (-c)
+static int battery = 0;             // Alimentação por bateria (-v)
+static double batt_start_v = AVCC_V, batt_end_v = AVCC_V;
+static double avcc_min = 99.0;
+static uint64_t brownout_ps = 0;
+
+/* * RUÍDO DETERMINÍSTICO * */
+static double rand_unit(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (double)(rng >> 11) / (double)(1ULL << 53);
+}
+
+static double rand_normal(void)
+{
+    double u1 = rand_unit(), u2 = rand_unit();
+    if (u1 < 1e-12) u1 = 1e-12;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* * CARGAS EXTERNAS * */
+// Pino da bomba como GPIO ou como TA1.1 (PWM): fração do tempo com a bomba ligada
+static double pump_duty(int z)
+{
+    uint16_t pin = zones[z].pump_pin;
+    if (!(sim_regs[SIM_P2DIR] & pin)) return 0.0;
+    if (zones[z].pwm && (sim_regs[SIM_P2SEL] & pin)) return sim_timer_duty(1, 1);
+    return (sim_regs[SIM_P2OUT] & pin) ? 1.0 : 0.0;
+}
+
+// Porta da luz de fundo: P1.2 sem acionar (entrada) deixa a luz habilitada,
+// como o jumper do backpack; como TA0.1 vale o ciclo de trabalho do PWM
+static double backlight_gate(void)
+{
+    if (!(sim_regs[SIM_P1DIR] & BL_GATE_PIN)) return 1.0;
+    if (sim_regs[SIM_P1SEL] & BL_GATE_PIN) return sim_timer_duty(0, 1);
+    return (sim_regs[SIM_P1OUT] & BL_GATE_PIN) ? 1.0 : 0.0;
+}
+
+static int sensor_powered(void)
+{
+    return (sim_regs[SIM_P6DIR] & BIT1) && (sim_regs[SIM_P6OUT] & BIT1);
+}
+
+static double moisture(int z)
+{
+    double h = (double)sim_now / SIM_PS_PER_S / 3600.0 - z * ZONE_LAG_H;
+    double m = scenario->base(h) + water[z];
+    if (m < 0.0) m = 0.0;
+    if (m > 100.0) m = 100.0;
+    return m;
+}
+
+double bench_avcc(void)
+{
+    double f, v, load = 0.0;
+    int z;
+
+    if (!battery) return AVCC_V;
+    f = (double)sim_now / ((double)days * 86400.0 * SIM_PS_PER_S);
+    for (z = 0; z < NZONES; z++) load += pump_duty(z);
+    v = batt_start_v + (batt_end_v - batt_start_v) * f - BATT_SAG_V * load;
+    return v;
+}
+
+// A sonda é um divisor alimentado por P6.1: tensão alta = solo seco
+double bench_analog(int inch)
+{
+    int z;
+    for (z = 0; z < NZONES && zones[z].inch != inch; z++);
+    if (z == NZONES || !sensor_powered()) return 0.0;
+
+    double t = (double)sensor_on_ps / SIM_PS_PER_S;
+    double v = bench_avcc() * pow(1.0 - moisture(z) / 100.0, probe_k) * (1.0 - exp(-t / SENSOR_TAU_S));
+    v += NOISE_V * rand_normal();
+    if (rand_unit() < SPIKE_PROB) v += (rand_unit() < 0.5 ? -SPIKE_V : SPIKE_V);
+    return v;
+}
+
+void bench_segment(uint64_t dt)
+{
+    double dt_s = (double)dt / SIM_PS_PER_S;
+
+    double total = 0.0, step = 0.0;
+    int z;
+    for (z = 0; z < NZONES; z++)
+    {
+        double duty = pump_duty(z);
+        if (duty > 0.0)
+        {
+            if (pump_duty_last[z] == 0.0) pump_starts++;
+            water[z] += PUMP_GAIN_PCT_S * duty * dt_s;
+        }
+        step += duty - pump_duty_last[z];
+        total += duty;
+        pump_duty_last[z] = duty;
+        water[z] *= exp(-dt_s / (WATER_TAU_H * 3600.0));
+    }
+    if (total > 0.0)
+    {
+        pump_ps += dt;
+        pump_full_ps += total * dt;
+    }
+    if (step > pump_max_step) pump_max_step = step;
+    if (total > pump_peak) pump_peak = total;
+
+    if (sensor_powered())
+    {
+        sensor_on_ps += dt;
+        sensor_total_ps += dt;
+    }
+    else sensor_on_ps = 0;
+
+    if (sim_pcf8574() & BIT3) backlight_ps += backlight_gate() * dt;
+
+    double v = bench_avcc();
+    if (v < avcc_min) avcc_min = v;
+    if (v < BROWNOUT_V) brownout_ps += dt;
+}
+
+// Início do toque n: horários espaçados igualmente a partir de meio intervalo
+static uint64_t press_time(uint32_t n)
+{
+    uint64_t period = 86400ULL * SIM_PS_PER_S / (uint64_t)presses_per_day;
+    return n * period + period / 2;
+}
+
+uint64_t bench_input_next(void)
+{
+    if (presses_per_day <= 0) return SIM_NEVER;
+    return press_time(presses) + (press_down ? PRESS_PS : 0);
+}
+
+// Toques pares em S1 (P2.1), ímpares em S2 (P1.1); ativos em 0
+void bench_input(void)
+{
+    int port = (presses & 1) ? 1 : 2;
+    press_down = !press_down;
+    sim_port_in(port, BIT1, !press_down);
+    if (!press_down) presses++;
+}
+
+/* * RELATÓRIO * */
+static double hours(uint64_t ps)
+{
+    return (double)ps / SIM_PS_PER_S / 3600.0;
+}
+
+void bench_finish(void)
+{
+    const sim_stats_t *s = &sim_stats;
+    double total_h = hours(sim_now);
+    double q_active = I_ACTIVE * hours(s->active_ps);
+    double mclk = 0, ram = 0;
+    int v;
+
+    // Ciclos / 3.6e9 = MHz x horas
+    for (v = 0; v < 4; v++)
+    {
+        q_active += I_ACTIVE_PER_MHZ[v] * (s->mclk_cycles[v] - s->ram_cycles[v]) / 3.6e9
+                  + I_ACTIVE_RAM_PER_MHZ[v] * s->ram_cycles[v] / 3.6e9;
+        mclk += s->mclk_cycles[v];
+        ram += s->ram_cycles[v];
+    }
+    double q_cpu = q_active + I_LPM0 * hours(s->lpm0_ps)
+                 + I_LPM0_PER_MHZ * s->lpm0_dco_cycles / 3.6e9
+                 + I_LPM3 * hours(s->lpm3_ps) + I_REFO * hours(s->refo_ps);
+    double q_adc = I_ADC * hours(s->adc_on_ps) + I_REF * hours(s->ref_on_ps)
+                 + I_COMP * hours(s->comp_on_ps);
+    double q_bus = I_I2C_BUSY * hours(s->i2c_busy_ps) + I_UART_BUSY * hours(s->uart_busy_ps)
+                 + I_FLASH * hours(s->flash_busy_ps);
+    double q_sensor = I_SENSOR * hours(sensor_total_ps);
+    double q_pump = I_PUMP * hours((uint64_t)pump_full_ps);
+    double q_lcd = I_LCD_LOGIC * total_h;
+    double q_bl = I_BACKLIGHT * backlight_ps / SIM_PS_PER_S / 3600.0;
+    double q_total = q_cpu + q_adc + q_bus + q_sensor + q_pump + q_lcd + q_bl;
+
+    char line0[17], line1[17];
+    sim_lcd_line(0, line0);
+    sim_lcd_line(1, line1);
+
+    printf("{\"scenario\":\"%s\",\"days\":%d,", scenario->name, days);
+    printf("\"wakeups\":%u,\"interrupts\":%u,", s->wakeups, s->interrupts);
+    printf("\"active_ms\":%.3f,\"active_cycles\":%llu,", s->active_ps / 1e9,
+           (unsigned long long)s->active_cycles);
+    printf("\"ram_cycles\":%.0f,\"ram_pct\":%.1f,", ram, mclk > 0 ? 100.0 * ram / mclk : 0.0);
+    printf("\"lpm0_ms\":%.3f,\"lpm3_s\":%.1f,", s->lpm0_ps / 1e9, s->lpm3_ps / 1e12);
+    printf("\"mclk_hz\":%u,\"refo_s\":%.1f,\"vcore_violation_ms\":%.3f,",
+           sim_clock_hz(SIM_MCLK), s->refo_ps / 1e12, s->vcore_violation_ps / 1e9);
+    printf("\"i2c_starts\":%u,\"i2c_bytes\":%u,\"i2c_nacks\":%u,", s->i2c_starts,
+           s->i2c_bytes, s->i2c_nacks);
+    printf("\"uart_bytes\":%u,\"adc_conversions\":%u,\"comp_on_ms\":%.3f,", s->uart_bytes,
+           s->adc_conversions, s->comp_on_ps / 1e9);
+    printf("\"pump_on_s\":%.1f,\"pump_full_s\":%.1f,\"pump_starts\":%u,"
+           "\"pump_max_step\":%.3f,\"pump_peak\":%.3f,", pump_ps / 1e12, pump_full_ps / 1e12,
+           pump_starts, pump_max_step, pump_peak);
+    printf("\"sensor_on_s\":%.3f,\"backlight_s\":%.1f,\"button_presses\":%u,",
+           sensor_total_ps / 1e12, backlight_ps / 1e12, presses);
+    printf("\"lcd_instructions\":%u,\"lcd_violations\":%u,", s->lcd_instructions,
+           s->lcd_violations);
+    printf("\"flash_erases\":%u,\"flash_words\":%u,\"dma_transfers\":%u,", s->flash_erases,
+           s->flash_words, s->dma_transfers);
+    printf("\"charge_mAh\":{\"cpu\":%.6f,\"adc\":%.6f,\"bus\":%.6f,\"sensor\":%.6f,"
+           "\"pump\":%.3f,\"lcd\":%.3f,\"backlight\":%.3f,\"total\":%.3f},",
+           q_cpu, q_adc, q_bus, q_sensor, q_pump, q_lcd, q_bl, q_total);
+    printf("\"charge_mAh_per_day\":%.3f,\"final_moisture\":%.1f,", q_total / (total_h / 24.0),
+           moisture(0));
+    printf("\"avcc_min\":%.3f,\"brownout_ms\":%.3f,", avcc_min, brownout_ps / 1e9);
+    printf("\"lcd\":[\"%s\",\"%s\"]}\n", line0, line1);
+    fflush(stdout);
+
+    if (info_path)
+    {
+        FILE *f = fopen(info_path, "wb");
+        if (!f || fwrite(sim_info_mem, sizeof(sim_info_mem), 1, f) != 1) perror(info_path);
+        if (f) fclose(f);
+    }
+}
+
+/* * CALIBRAÇÃO * */
+// Código do ADC (12 bits) com a sonda estabilizada em cada umidade de
+// 100 % a 0 %, em passos iguais; o mesmo para todos os canteiros
+static void install_calibration(void)
+{
+    uint16_t w[1 + CAL_SLOTS * CAL_POINTS * 2 + 1];
+    uint16_t sum = 0;
+    int n = 0, z, i;
+
+    w[n++] = CAL_MAGIC;
+    for (z = 0; z < CAL_SLOTS; z++)
+    {
+        for (i = 0; i < CAL_POINTS; i++)
+        {
+            double pct = 100.0 - 100.0 * i / (CAL_POINTS - 1);
+            double code = 4096.0 * pow(1.0 - pct / 100.0, probe_k);
+            w[n++] = code > 4095.0 ? 4095 : (uint16_t)code;
+            w[n++] = (uint16_t)pct;
+        }
+    }
+    for (i = 0; i < n; i++) sum += w[i];
+    w[n++] = (uint16_t)~sum;
+    memcpy(sim_info_mem + CAL_OFFSET, w, sizeof(w));
+}
+
+/* * EXECUÇÃO * */
+static void run(const scenario_t *sc, unsigned long seed, const char *uart_path)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0)
+    {
+        // Cada cenário roda num processo novo: o firmware começa do reset
+        scenario = sc;
+        rng = seed * 2654435761UL + 1;
+        if (uart_path)
+        {
+            sim_uart_log = fopen(uart_path, "wb");
+            if (!sim_uart_log) { perror(uart_path); exit(1); }
+        }
+        if (info_path)
+        {
+            FILE *f = fopen(info_path, "rb");
+            if (f)
+            {
+                if (fread(sim_info_mem, sizeof(sim_info_mem), 1, f) != 1)
+                    fprintf(stderr, "bench: %s incompleto\n", info_path);
+                fclose(f);
+            }
+        }
+        if (probe_cal) install_calibration();
+        sim_run(firmware_main, (uint64_t)days * 86400ULL * SIM_PS_PER_S);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "bench: cenário %s falhou\n", sc->name);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *only = 0, *uart_path = 0;
+    unsigned long seed = 1;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "d:s:u:r:f:b:k:cv:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd': days = atoi(optarg); break;
+        case 's': only = optarg; break;
+        case 'u': uart_path = optarg; break;
+        case 'r': seed = strtoul(optarg, 0, 10); break;
+        case 'f': info_path = optarg; break;
+        case 'b': presses_per_day = atoi(optarg); break;
+        case 'k': probe_k = atof(optarg); break;
+        case 'c': probe_cal = 1; break;
+        case 'v':
+            battery = 1;
+            if (sscanf(optarg, "%lf:%lf", &batt_start_v, &batt_end_v) != 2)
+                batt_end_v = batt_start_v;
+            break;
+        default:
+            fprintf(stderr, "uso: %s [-d dias] [-s cenário] [-u arquivo_uart] [-r semente] "
+                    "[-f arquivo_info] [-b toques_por_dia] [-k curvatura] [-c] "
+                    "[-v volts_início:volts_fim]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < NSCENARIOS; i++)
+    {
+        if (only && strcmp(only, scenarios[i].name) != 0) continue;
+        run(&scenarios[i], seed, uart_path);
+    }
+    return 0;
+}
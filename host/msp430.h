@@ -0,0 +1,668 @@
+/*
+ * msp430.h DO MODELO DE HOST
+ *
+ * Substitui o <msp430.h> do CCS quando o ProjetoFinal.c é compilado no PC
+ * (ver Makefile). Cada registrador vira uma chamada a sim_reg(), que avança
+ * o tempo virtual, entrega interrupções e aplica os efeitos colaterais de
+ * leitura/escrita modelados em sim.c. Os valores dos bits seguem o
+ * msp430f5529.h do TI.
+ */
+#ifndef SIM_MSP430_H
+#define SIM_MSP430_H
+
+#include <stdint.h>
+
+/* * REGISTRADORES * */
+// Lista X: a ordem importa onde o firmware usa aritmética de ponteiro
+// (ADC12MCTL0..15, ADC12MEM0..15, TAxCCTLn, TAxCCRn são consecutivos).
+#define SIM_REGISTERS(X) \
+    X(WDTCTL) X(SFRIE1) X(SFRIFG1) X(SFRRPCR) X(P1IN) X(P1OUT) \
+    X(P1DIR) X(P1REN) X(P1DS) X(P1SEL) X(P1IES) X(P1IE) \
+    X(P1IFG) X(P1IV) X(P2IN) X(P2OUT) X(P2DIR) X(P2REN) \
+    X(P2DS) X(P2SEL) X(P2IES) X(P2IE) X(P2IFG) X(P2IV) \
+    X(P3IN) X(P3OUT) X(P3DIR) X(P3REN) X(P3DS) X(P3SEL) \
+    X(P4IN) X(P4OUT) X(P4DIR) X(P4REN) X(P4DS) X(P4SEL) \
+    X(P5IN) X(P5OUT) X(P5DIR) X(P5REN) X(P5DS) X(P5SEL) \
+    X(P6IN) X(P6OUT) X(P6DIR) X(P6REN) X(P6DS) X(P6SEL) \
+    X(P7IN) X(P7OUT) X(P7DIR) X(P7REN) X(P7DS) X(P7SEL) \
+    X(P8IN) X(P8OUT) X(P8DIR) X(P8REN) X(P8DS) X(P8SEL) \
+    X(TA0CTL) X(TA0R) X(TA0CCTL0) X(TA0CCTL1) X(TA0CCTL2) X(TA0CCTL3) \
+    X(TA0CCTL4) X(TA0CCR0) X(TA0CCR1) X(TA0CCR2) X(TA0CCR3) X(TA0CCR4) \
+    X(TA0EX0) X(TA0IV) X(TA1CTL) X(TA1R) X(TA1CCTL0) X(TA1CCTL1) \
+    X(TA1CCTL2) X(TA1CCR0) X(TA1CCR1) X(TA1CCR2) X(TA1EX0) X(TA1IV) \
+    X(TA2CTL) X(TA2R) X(TA2CCTL0) X(TA2CCTL1) X(TA2CCTL2) X(TA2CCR0) \
+    X(TA2CCR1) X(TA2CCR2) X(TA2EX0) X(TA2IV) X(TB0CTL) X(TB0R) \
+    X(TB0CCTL0) X(TB0CCTL1) X(TB0CCTL2) X(TB0CCTL3) X(TB0CCTL4) X(TB0CCTL5) \
+    X(TB0CCTL6) X(TB0CCR0) X(TB0CCR1) X(TB0CCR2) X(TB0CCR3) X(TB0CCR4) \
+    X(TB0CCR5) X(TB0CCR6) X(TB0EX0) X(TB0IV) X(ADC12CTL0) X(ADC12CTL1) \
+    X(ADC12CTL2) X(ADC12IFG) X(ADC12IE) X(ADC12IV) X(ADC12MCTL0) X(ADC12MCTL1) \
+    X(ADC12MCTL2) X(ADC12MCTL3) X(ADC12MCTL4) X(ADC12MCTL5) X(ADC12MCTL6) X(ADC12MCTL7) \
+    X(ADC12MCTL8) X(ADC12MCTL9) X(ADC12MCTL10) X(ADC12MCTL11) X(ADC12MCTL12) X(ADC12MCTL13) \
+    X(ADC12MCTL14) X(ADC12MCTL15) X(ADC12MEM0) X(ADC12MEM1) X(ADC12MEM2) X(ADC12MEM3) \
+    X(ADC12MEM4) X(ADC12MEM5) X(ADC12MEM6) X(ADC12MEM7) X(ADC12MEM8) X(ADC12MEM9) \
+    X(ADC12MEM10) X(ADC12MEM11) X(ADC12MEM12) X(ADC12MEM13) X(ADC12MEM14) X(ADC12MEM15) \
+    X(REFCTL0) X(UCB0CTL0) X(UCB0CTL1) X(UCB0BR0) X(UCB0BR1) X(UCB0STAT) \
+    X(UCB0RXBUF) X(UCB0TXBUF) X(UCB0I2COA) X(UCB0I2CSA) X(UCB0IE) X(UCB0IFG) \
+    X(UCB0IV) X(UCA1CTL0) X(UCA1CTL1) X(UCA1BR0) X(UCA1BR1) X(UCA1MCTL) \
+    X(UCA1STAT) X(UCA1RXBUF) X(UCA1TXBUF) X(UCA1IE) X(UCA1IFG) X(UCA1IV) \
+    X(FCTL1) X(FCTL3) X(FCTL4) X(RTCCTL01) X(RTCCTL23) X(RTCPS0CTL) \
+    X(RTCPS1CTL) X(RTCPS) X(RTCIV) X(RTCNT12) X(RTCNT34) X(UCSCTL0) \
+    X(UCSCTL1) X(UCSCTL2) X(UCSCTL3) X(UCSCTL4) X(UCSCTL5) X(UCSCTL6) \
+    X(UCSCTL7) X(UCSCTL8) X(PMMCTL0) X(PMMCTL0_H) X(PMMIFG) X(SVSMHCTL) \
+    X(SVSMLCTL) \
+    X(DMACTL0) X(DMACTL1) X(DMACTL2) X(DMACTL3) X(DMACTL4) X(DMAIV) \
+    X(DMA0CTL) X(DMA0SA) X(DMA0DA) X(DMA0SZ) \
+    X(MPY) X(MPYS) X(MAC) X(MACS) X(OP2) X(RESLO) \
+    X(RESHI) X(SUMEXT) X(MPY32CTL0) \
+    X(CBCTL0) X(CBCTL1) X(CBCTL2) X(CBCTL3) X(CBINT) X(CBIV) \
+
+enum {
+#define SIM_ENUM(n) SIM_##n,
+    SIM_REGISTERS(SIM_ENUM)
+#undef SIM_ENUM
+    SIM_NREGS
+};
+
+volatile uint16_t *sim_reg(int id);
+#define SIM_REG(n) (*sim_reg(SIM_##n))
+
+#define WDTCTL       SIM_REG(WDTCTL)
+#define SFRIE1       SIM_REG(SFRIE1)
+#define SFRIFG1      SIM_REG(SFRIFG1)
+#define SFRRPCR      SIM_REG(SFRRPCR)
+#define P1IN         SIM_REG(P1IN)
+#define P1OUT        SIM_REG(P1OUT)
+#define P1DIR        SIM_REG(P1DIR)
+#define P1REN        SIM_REG(P1REN)
+#define P1DS         SIM_REG(P1DS)
+#define P1SEL        SIM_REG(P1SEL)
+#define P1IES        SIM_REG(P1IES)
+#define P1IE         SIM_REG(P1IE)
+#define P1IFG        SIM_REG(P1IFG)
+#define P1IV         SIM_REG(P1IV)
+#define P2IN         SIM_REG(P2IN)
+#define P2OUT        SIM_REG(P2OUT)
+#define P2DIR        SIM_REG(P2DIR)
+#define P2REN        SIM_REG(P2REN)
+#define P2DS         SIM_REG(P2DS)
+#define P2SEL        SIM_REG(P2SEL)
+#define P2IES        SIM_REG(P2IES)
+#define P2IE         SIM_REG(P2IE)
+#define P2IFG        SIM_REG(P2IFG)
+#define P2IV         SIM_REG(P2IV)
+#define P3IN         SIM_REG(P3IN)
+#define P3OUT        SIM_REG(P3OUT)
+#define P3DIR        SIM_REG(P3DIR)
+#define P3REN        SIM_REG(P3REN)
+#define P3DS         SIM_REG(P3DS)
+#define P3SEL        SIM_REG(P3SEL)
+#define P4IN         SIM_REG(P4IN)
+#define P4OUT        SIM_REG(P4OUT)
+#define P4DIR        SIM_REG(P4DIR)
+#define P4REN        SIM_REG(P4REN)
+#define P4DS         SIM_REG(P4DS)
+#define P4SEL        SIM_REG(P4SEL)
+#define P5IN         SIM_REG(P5IN)
+#define P5OUT        SIM_REG(P5OUT)
+#define P5DIR        SIM_REG(P5DIR)
+#define P5REN        SIM_REG(P5REN)
+#define P5DS         SIM_REG(P5DS)
+#define P5SEL        SIM_REG(P5SEL)
+#define P6IN         SIM_REG(P6IN)
+#define P6OUT        SIM_REG(P6OUT)
+#define P6DIR        SIM_REG(P6DIR)
+#define P6REN        SIM_REG(P6REN)
+#define P6DS         SIM_REG(P6DS)
+#define P6SEL        SIM_REG(P6SEL)
+#define P7IN         SIM_REG(P7IN)
+#define P7OUT        SIM_REG(P7OUT)
+#define P7DIR        SIM_REG(P7DIR)
+#define P7REN        SIM_REG(P7REN)
+#define P7DS         SIM_REG(P7DS)
+#define P7SEL        SIM_REG(P7SEL)
+#define P8IN         SIM_REG(P8IN)
+#define P8OUT        SIM_REG(P8OUT)
+#define P8DIR        SIM_REG(P8DIR)
+#define P8REN        SIM_REG(P8REN)
+#define P8DS         SIM_REG(P8DS)
+#define P8SEL        SIM_REG(P8SEL)
+#define TA0CTL       SIM_REG(TA0CTL)
+#define TA0R         SIM_REG(TA0R)
+#define TA0CCTL0     SIM_REG(TA0CCTL0)
+#define TA0CCTL1     SIM_REG(TA0CCTL1)
+#define TA0CCTL2     SIM_REG(TA0CCTL2)
+#define TA0CCTL3     SIM_REG(TA0CCTL3)
+#define TA0CCTL4     SIM_REG(TA0CCTL4)
+#define TA0CCR0      SIM_REG(TA0CCR0)
+#define TA0CCR1      SIM_REG(TA0CCR1)
+#define TA0CCR2      SIM_REG(TA0CCR2)
+#define TA0CCR3      SIM_REG(TA0CCR3)
+#define TA0CCR4      SIM_REG(TA0CCR4)
+#define TA0EX0       SIM_REG(TA0EX0)
+#define TA0IV        SIM_REG(TA0IV)
+#define TA1CTL       SIM_REG(TA1CTL)
+#define TA1R         SIM_REG(TA1R)
+#define TA1CCTL0     SIM_REG(TA1CCTL0)
+#define TA1CCTL1     SIM_REG(TA1CCTL1)
+#define TA1CCTL2     SIM_REG(TA1CCTL2)
+#define TA1CCR0      SIM_REG(TA1CCR0)
+#define TA1CCR1      SIM_REG(TA1CCR1)
+#define TA1CCR2      SIM_REG(TA1CCR2)
+#define TA1EX0       SIM_REG(TA1EX0)
+#define TA1IV        SIM_REG(TA1IV)
+#define TA2CTL       SIM_REG(TA2CTL)
+#define TA2R         SIM_REG(TA2R)
+#define TA2CCTL0     SIM_REG(TA2CCTL0)
+#define TA2CCTL1     SIM_REG(TA2CCTL1)
+#define TA2CCTL2     SIM_REG(TA2CCTL2)
+#define TA2CCR0      SIM_REG(TA2CCR0)
+#define TA2CCR1      SIM_REG(TA2CCR1)
+#define TA2CCR2      SIM_REG(TA2CCR2)
+#define TA2EX0       SIM_REG(TA2EX0)
+#define TA2IV        SIM_REG(TA2IV)
+#define TB0CTL       SIM_REG(TB0CTL)
+#define TB0R         SIM_REG(TB0R)
+#define TB0CCTL0     SIM_REG(TB0CCTL0)
+#define TB0CCTL1     SIM_REG(TB0CCTL1)
+#define TB0CCTL2     SIM_REG(TB0CCTL2)
+#define TB0CCTL3     SIM_REG(TB0CCTL3)
+#define TB0CCTL4     SIM_REG(TB0CCTL4)
+#define TB0CCTL5     SIM_REG(TB0CCTL5)
+#define TB0CCTL6     SIM_REG(TB0CCTL6)
+#define TB0CCR0      SIM_REG(TB0CCR0)
+#define TB0CCR1      SIM_REG(TB0CCR1)
+#define TB0CCR2      SIM_REG(TB0CCR2)
+#define TB0CCR3      SIM_REG(TB0CCR3)
+#define TB0CCR4      SIM_REG(TB0CCR4)
+#define TB0CCR5      SIM_REG(TB0CCR5)
+#define TB0CCR6      SIM_REG(TB0CCR6)
+#define TB0EX0       SIM_REG(TB0EX0)
+#define TB0IV        SIM_REG(TB0IV)
+#define ADC12CTL0    SIM_REG(ADC12CTL0)
+#define ADC12CTL1    SIM_REG(ADC12CTL1)
+#define ADC12CTL2    SIM_REG(ADC12CTL2)
+#define ADC12IFG     SIM_REG(ADC12IFG)
+#define ADC12IE      SIM_REG(ADC12IE)
+#define ADC12IV      SIM_REG(ADC12IV)
+#define ADC12MCTL0   SIM_REG(ADC12MCTL0)
+#define ADC12MCTL1   SIM_REG(ADC12MCTL1)
+#define ADC12MCTL2   SIM_REG(ADC12MCTL2)
+#define ADC12MCTL3   SIM_REG(ADC12MCTL3)
+#define ADC12MCTL4   SIM_REG(ADC12MCTL4)
+#define ADC12MCTL5   SIM_REG(ADC12MCTL5)
+#define ADC12MCTL6   SIM_REG(ADC12MCTL6)
+#define ADC12MCTL7   SIM_REG(ADC12MCTL7)
+#define ADC12MCTL8   SIM_REG(ADC12MCTL8)
+#define ADC12MCTL9   SIM_REG(ADC12MCTL9)
+#define ADC12MCTL10  SIM_REG(ADC12MCTL10)
+#define ADC12MCTL11  SIM_REG(ADC12MCTL11)
+#define ADC12MCTL12  SIM_REG(ADC12MCTL12)
+#define ADC12MCTL13  SIM_REG(ADC12MCTL13)
+#define ADC12MCTL14  SIM_REG(ADC12MCTL14)
+#define ADC12MCTL15  SIM_REG(ADC12MCTL15)
+#define ADC12MEM0    SIM_REG(ADC12MEM0)
+#define ADC12MEM1    SIM_REG(ADC12MEM1)
+#define ADC12MEM2    SIM_REG(ADC12MEM2)
+#define ADC12MEM3    SIM_REG(ADC12MEM3)
+#define ADC12MEM4    SIM_REG(ADC12MEM4)
+#define ADC12MEM5    SIM_REG(ADC12MEM5)
+#define ADC12MEM6    SIM_REG(ADC12MEM6)
+#define ADC12MEM7    SIM_REG(ADC12MEM7)
+#define ADC12MEM8    SIM_REG(ADC12MEM8)
+#define ADC12MEM9    SIM_REG(ADC12MEM9)
+#define ADC12MEM10   SIM_REG(ADC12MEM10)
+#define ADC12MEM11   SIM_REG(ADC12MEM11)
+#define ADC12MEM12   SIM_REG(ADC12MEM12)
+#define ADC12MEM13   SIM_REG(ADC12MEM13)
+#define ADC12MEM14   SIM_REG(ADC12MEM14)
+#define ADC12MEM15   SIM_REG(ADC12MEM15)
+#define REFCTL0      SIM_REG(REFCTL0)
+#define UCB0CTL0     SIM_REG(UCB0CTL0)
+#define UCB0CTL1     SIM_REG(UCB0CTL1)
+#define UCB0BR0      SIM_REG(UCB0BR0)
+#define UCB0BR1      SIM_REG(UCB0BR1)
+#define UCB0STAT     SIM_REG(UCB0STAT)
+#define UCB0RXBUF    SIM_REG(UCB0RXBUF)
+#define UCB0TXBUF    SIM_REG(UCB0TXBUF)
+#define UCB0I2COA    SIM_REG(UCB0I2COA)
+#define UCB0I2CSA    SIM_REG(UCB0I2CSA)
+#define UCB0IE       SIM_REG(UCB0IE)
+#define UCB0IFG      SIM_REG(UCB0IFG)
+#define UCB0IV       SIM_REG(UCB0IV)
+#define UCA1CTL0     SIM_REG(UCA1CTL0)
+#define UCA1CTL1     SIM_REG(UCA1CTL1)
+#define UCA1BR0      SIM_REG(UCA1BR0)
+#define UCA1BR1      SIM_REG(UCA1BR1)
+#define UCA1MCTL     SIM_REG(UCA1MCTL)
+#define UCA1STAT     SIM_REG(UCA1STAT)
+#define UCA1RXBUF    SIM_REG(UCA1RXBUF)
+#define UCA1TXBUF    SIM_REG(UCA1TXBUF)
+#define UCA1IE       SIM_REG(UCA1IE)
+#define UCA1IFG      SIM_REG(UCA1IFG)
+#define UCA1IV       SIM_REG(UCA1IV)
+#define FCTL1        SIM_REG(FCTL1)
+#define FCTL3        SIM_REG(FCTL3)
+#define FCTL4        SIM_REG(FCTL4)
+#define RTCCTL01     SIM_REG(RTCCTL01)
+#define RTCCTL23     SIM_REG(RTCCTL23)
+#define RTCPS0CTL    SIM_REG(RTCPS0CTL)
+#define RTCPS1CTL    SIM_REG(RTCPS1CTL)
+#define RTCPS        SIM_REG(RTCPS)
+#define RTCIV        SIM_REG(RTCIV)
+#define RTCNT12      SIM_REG(RTCNT12)
+#define RTCNT34      SIM_REG(RTCNT34)
+#define UCSCTL0      SIM_REG(UCSCTL0)
+#define UCSCTL1      SIM_REG(UCSCTL1)
+#define UCSCTL2      SIM_REG(UCSCTL2)
+#define UCSCTL3      SIM_REG(UCSCTL3)
+#define UCSCTL4      SIM_REG(UCSCTL4)
+#define UCSCTL5      SIM_REG(UCSCTL5)
+#define UCSCTL6      SIM_REG(UCSCTL6)
+#define UCSCTL7      SIM_REG(UCSCTL7)
+#define UCSCTL8      SIM_REG(UCSCTL8)
+#define PMMCTL0      SIM_REG(PMMCTL0)
+#define PMMCTL0_H    SIM_REG(PMMCTL0_H)  // Byte alto (senha) como registrador à parte
+#define PMMIFG       SIM_REG(PMMIFG)
+#define SVSMHCTL     SIM_REG(SVSMHCTL)
+#define SVSMLCTL     SIM_REG(SVSMLCTL)
+#define DMACTL0      SIM_REG(DMACTL0)
+#define DMACTL1      SIM_REG(DMACTL1)
+#define DMACTL2      SIM_REG(DMACTL2)
+#define DMACTL3      SIM_REG(DMACTL3)
+#define DMACTL4      SIM_REG(DMACTL4)
+#define DMAIV        SIM_REG(DMAIV)
+#define DMA0CTL      SIM_REG(DMA0CTL)
+#define DMA0SA       SIM_REG(DMA0SA)   // Endereços de 20 bits: ver __data16_write_addr
+#define DMA0DA       SIM_REG(DMA0DA)
+#define DMA0SZ       SIM_REG(DMA0SZ)
+#define MPY          SIM_REG(MPY)
+#define MPYS         SIM_REG(MPYS)
+#define MAC          SIM_REG(MAC)
+#define MACS         SIM_REG(MACS)
+#define OP2          SIM_REG(OP2)
+#define RESLO        SIM_REG(RESLO)
+#define RESHI        SIM_REG(RESHI)
+#define SUMEXT       SIM_REG(SUMEXT)
+#define MPY32CTL0    SIM_REG(MPY32CTL0)
+#define CBCTL0       SIM_REG(CBCTL0)
+#define CBCTL1       SIM_REG(CBCTL1)
+#define CBCTL2       SIM_REG(CBCTL2)
+#define CBCTL3       SIM_REG(CBCTL3)
+#define CBINT        SIM_REG(CBINT)
+#define CBIV         SIM_REG(CBIV)
+
+// Memória de informação (segmentos D..A, 0x1800-0x19FF). O firmware só
+// acessa 0x1800 via INFO_MEM, que aqui aponta para um vetor do modelo.
+extern uint8_t sim_info_mem[512];
+#define INFO_MEM sim_info_mem
+
+// Flash principal: os vetores FLASH_CONST ficam graváveis e alinhados como
+// segmentos, e a escrita fictícia do apagamento vai para o modelo
+void sim_flash_dummy_write(volatile void *p);
+#define FLASH_DUMMY_WRITE(p) sim_flash_dummy_write(p)
+#define FLASH_CONST __attribute__((aligned(512)))
+
+/* * BITS * */
+#define BIT0  0x0001
+#define BIT1  0x0002
+#define BIT2  0x0004
+#define BIT3  0x0008
+#define BIT4  0x0010
+#define BIT5  0x0020
+#define BIT6  0x0040
+#define BIT7  0x0080
+#define BIT8  0x0100
+#define BIT9  0x0200
+#define BITA  0x0400
+#define BITB  0x0800
+#define BITC  0x1000
+#define BITD  0x2000
+#define BITE  0x4000
+#define BITF  0x8000
+
+// Registrador de status
+#define GIE        0x0008
+#define CPUOFF     0x0010
+#define OSCOFF     0x0020
+#define SCG0       0x0040
+#define SCG1       0x0080
+#define LPM0_bits  (CPUOFF)
+#define LPM1_bits  (SCG0 + CPUOFF)
+#define LPM2_bits  (SCG1 + CPUOFF)
+#define LPM3_bits  (SCG1 + SCG0 + CPUOFF)
+#define LPM4_bits  (SCG1 + SCG0 + OSCOFF + CPUOFF)
+
+// Watchdog
+#define WDTPW      0x5A00
+#define WDTHOLD    0x0080
+
+/* Timer_A / Timer_B */
+#define TASSEL_0   0x0000
+#define TASSEL_1   0x0100
+#define TASSEL_2   0x0200
+#define TASSEL_3   0x0300
+#define TASSEL__TACLK 0x0000
+#define TASSEL__ACLK  0x0100
+#define TASSEL__SMCLK 0x0200
+#define TASSEL__INCLK 0x0300
+#define ID_0       0x0000
+#define ID_1       0x0040
+#define ID_2       0x0080
+#define ID_3       0x00C0
+#define ID__1      0x0000
+#define ID__2      0x0040
+#define ID__4      0x0080
+#define ID__8      0x00C0
+#define MC_0       0x0000
+#define MC_1       0x0010
+#define MC_2       0x0020
+#define MC_3       0x0030
+#define MC__STOP   0x0000
+#define MC__UP     0x0010
+#define MC__CONTINOUS   0x0020
+#define MC__CONTINUOUS  0x0020
+#define MC__UPDOWN 0x0030
+#define TACLR      0x0004
+#define TAIE       0x0002
+#define TAIFG      0x0001
+#define TAIDEX_0   0x0000
+#define TAIDEX_1   0x0001
+#define TAIDEX_2   0x0002
+#define TAIDEX_3   0x0003
+#define TAIDEX_4   0x0004
+#define TAIDEX_5   0x0005
+#define TAIDEX_6   0x0006
+#define TAIDEX_7   0x0007
+#define TBSSEL_1   0x0100
+#define TBSSEL_2   0x0200
+#define TBSSEL__ACLK  0x0100
+#define TBSSEL__SMCLK 0x0200
+#define TBCLR      0x0004
+#define TBIE       0x0002
+#define TBIFG      0x0001
+#define CM_0       0x0000
+#define CM_1       0x4000
+#define CM_2       0x8000
+#define CM_3       0xC000
+#define CCIS_0     0x0000
+#define CCIS_1     0x1000
+#define CCIS_2     0x2000
+#define CCIS_3     0x3000
+#define SCS        0x0800
+#define SCCI       0x0400
+#define CAP        0x0100
+#define OUTMOD_0   0x0000
+#define OUTMOD_1   0x0020
+#define OUTMOD_2   0x0040
+#define OUTMOD_3   0x0060
+#define OUTMOD_4   0x0080
+#define OUTMOD_5   0x00A0
+#define OUTMOD_6   0x00C0
+#define OUTMOD_7   0x00E0
+#define CCIE       0x0010
+#define CCI        0x0008
+#define OUT        0x0004
+#define COV        0x0002
+#define CCIFG      0x0001
+
+/* ADC12_A */
+#define ADC12SC       0x0001
+#define ADC12ENC      0x0002
+#define ADC12TOVIE    0x0004
+#define ADC12OVIE     0x0008
+#define ADC12ON       0x0010
+#define ADC12REFON    0x0020
+#define ADC12REF2_5V  0x0040
+#define ADC12MSC      0x0080
+#define ADC12SHT0_0   (0 << 8)
+#define ADC12SHT0_1   (1 << 8)
+#define ADC12SHT0_2   (2 << 8)
+#define ADC12SHT0_3   (3 << 8)
+#define ADC12SHT0_4   (4 << 8)
+#define ADC12SHT0_5   (5 << 8)
+#define ADC12SHT0_6   (6 << 8)
+#define ADC12SHT0_7   (7 << 8)
+#define ADC12SHT0_8   (8 << 8)
+#define ADC12SHT0_15  (15 << 8)
+#define ADC12SHT1_0   (0 << 12)
+#define ADC12SHT1_2   (2 << 12)
+#define ADC12SHT1_3   (3 << 12)
+#define ADC12SHT1_4   (4 << 12)
+#define ADC12SHT1_8   (8 << 12)
+#define ADC12SHT1_15  (15 << 12)
+#define ADC12BUSY     0x0001
+#define ADC12CONSEQ_0 (0 << 1)
+#define ADC12CONSEQ_1 (1 << 1)
+#define ADC12CONSEQ_2 (2 << 1)
+#define ADC12CONSEQ_3 (3 << 1)
+#define ADC12SSEL_0   (0 << 3)
+#define ADC12SSEL_1   (1 << 3)
+#define ADC12SSEL_2   (2 << 3)
+#define ADC12SSEL_3   (3 << 3)
+#define ADC12DIV_0    (0 << 5)
+#define ADC12DIV_1    (1 << 5)
+#define ADC12DIV_4    (4 << 5)
+#define ADC12DIV_7    (7 << 5)
+#define ADC12ISSH     0x0100
+#define ADC12SHP      0x0200
+#define ADC12SHS_0    (0 << 10)
+#define ADC12SHS_1    (1 << 10)
+#define ADC12CSTARTADD_0 (0 << 12)
+#define ADC12CSTARTADD_15 (15 << 12)
+#define ADC12REFBURST 0x0001
+#define ADC12REFOUT   0x0002
+#define ADC12SR       0x0004
+#define ADC12DF       0x0008
+#define ADC12RES_0    (0 << 4)
+#define ADC12RES_1    (1 << 4)
+#define ADC12RES_2    (2 << 4)
+#define ADC12TCOFF    0x0080
+#define ADC12PDIV     0x0100
+#define ADC12INCH_0   0
+#define ADC12INCH_1   1
+#define ADC12INCH_2   2
+#define ADC12INCH_3   3
+#define ADC12INCH_4   4
+#define ADC12INCH_5   5
+#define ADC12INCH_6   6
+#define ADC12INCH_7   7
+#define ADC12INCH_10  10
+#define ADC12INCH_11  11
+#define ADC12SREF_0   (0 << 4)
+#define ADC12SREF_1   (1 << 4)
+#define ADC12SREF_2   (2 << 4)
+#define ADC12EOS      0x0080
+
+/* REF_A */
+#define REFON      0x0001
+#define REFOUT     0x0002
+#define REFTCOFF   0x0008
+#define REFVSEL_0  0x0000
+#define REFVSEL_1  0x0010
+#define REFVSEL_2  0x0020
+#define REFVSEL_3  0x0030
+#define REFMSTR    0x0080
+#define REFGENBUSY 0x0400
+
+/* USCI */
+#define UCSWRST    0x0001
+#define UCTXSTT    0x0002
+#define UCTXSTP    0x0004
+#define UCTXNACK   0x0008
+#define UCTR       0x0010
+#define UCSSEL_0   0x0000
+#define UCSSEL_1   0x0040
+#define UCSSEL_2   0x0080
+#define UCSSEL_3   0x00C0
+#define UCSSEL__UCLK  0x0000
+#define UCSSEL__ACLK  0x0040
+#define UCSSEL__SMCLK 0x0080
+#define UCSYNC     0x0001
+#define UCMODE_0   0x0000
+#define UCMODE_1   0x0002
+#define UCMODE_2   0x0004
+#define UCMODE_3   0x0006
+#define UCMST      0x0008
+#define UCMM       0x0020
+#define UCSLA10    0x0040
+#define UCA10      0x0080
+#define UCBBUSY    0x0010
+#define UCBUSY     0x0001
+#define UCOS16     0x0001
+#define UCBRS_0    (0 << 1)
+#define UCBRS_1    (1 << 1)
+#define UCBRS_2    (2 << 1)
+#define UCBRS_3    (3 << 1)
+#define UCBRS_6    (6 << 1)
+#define UCBRF_0    (0 << 4)
+#define UCBRF_1    (1 << 4)
+#define UCRXIFG    0x0001
+#define UCTXIFG    0x0002
+#define UCSTTIFG   0x0004
+#define UCSTPIFG   0x0008
+#define UCALIFG    0x0010
+#define UCNACKIFG  0x0020
+#define UCRXIE     0x0001
+#define UCTXIE     0x0002
+#define UCSTTIE    0x0004
+#define UCSTPIE    0x0008
+#define UCALIE     0x0010
+#define UCNACKIE   0x0020
+#define FWKEY      0xA500
+#define FRKEY      0x9600
+#define ERASE      0x0002
+#define MERAS      0x0004
+#define WRT        0x0040
+#define BLKWRT     0x0080
+#define BUSY       0x0001
+#define KEYV       0x0002
+#define ACCVIFG    0x0004
+#define WAIT       0x0008
+#define LOCK       0x0010
+#define EMEX       0x0020
+#define LOCKA      0x0040
+#define RTCBCD     0x8000
+#define RTCHOLD    0x4000
+#define RTCMODE    0x2000
+#define RTCRDY     0x1000
+#define RTCSSEL_0  0x0000
+#define RTCSSEL_1  0x0400
+#define RTCSSEL_2  0x0800
+#define RTCSSEL_3  0x0C00
+#define RTCTEV_0   0x0000
+#define RTCTEV_1   0x0100
+#define RTCTEV_2   0x0200
+#define RTCTEV_3   0x0300
+#define RTCTEVIE   0x0040
+#define RTCAIE     0x0020
+#define RTCRDYIE   0x0010
+#define RTCTEVIFG  0x0004
+#define RTCAIFG    0x0002
+#define RTCRDYIFG  0x0001
+#define RT0PSHOLD  0x0100
+#define RT1PSHOLD  0x0100
+#define ACLKREQEN   0x0001
+#define MCLKREQEN   0x0002
+#define SMCLKREQEN  0x0004
+#define MODOSCREQEN 0x0008
+
+// UCS
+#define OFIFG        0x0002  // SFRIFG1
+#define DCORSEL_0    (0 << 4)
+#define DCORSEL_2    (2 << 4)
+#define DCORSEL_7    (7 << 4)
+#define FLLD_1       (1 << 12)
+#define FLLN_MASK    0x03FF
+#define SELREF__XT1CLK   (0 << 4)
+#define SELREF__REFOCLK  (2 << 4)
+#define FLLREFDIV_0  0x0000
+#define SELA__XT1CLK     (0 << 8)
+#define SELA__VLOCLK     (1 << 8)
+#define SELA__REFOCLK    (2 << 8)
+#define SELS__DCOCLKDIV  (4 << 4)
+#define SELM__DCOCLKDIV  (4 << 0)
+#define XT1OFF       0x0001
+#define SMCLKOFF     0x0002
+#define XCAP_3       (3 << 2)
+#define XT1DRIVE_0   (0 << 6)
+#define XT1DRIVE_3   (3 << 6)
+#define XT2OFF       0x0100
+#define DCOFFG       0x0001
+#define XT1LFOFFG    0x0002
+#define XT2OFFG      0x0008
+
+// PMM
+#define PMMPW        0xA500
+#define PMMPW_H      0xA5
+#define PMMCOREV_0   0x0000
+#define PMMCOREV_1   0x0001
+#define PMMCOREV_2   0x0002
+#define PMMCOREV_3   0x0003
+#define SVSMLDLYIFG  0x0001
+#define SVMLIFG      0x0002
+#define SVMLVLRIFG   0x0004
+#define SVSMHRRL0    0x0001
+#define SVSHRVL0     0x0100
+#define SVSHE        0x0400
+#define SVMHE        0x4000
+#define SVSMLRRL0    0x0001
+#define SVSLRVL0     0x0100
+#define SVSLE        0x0400
+#define SVMLE        0x4000
+#define DMA0TSEL_21          0x0015
+#define DMA0TSEL__UCA1TXIFG  0x0015
+#define DMADT_0      0x0000
+#define DMADT_4      0x4000
+#define DMADSTINCR_0 0x0000
+#define DMADSTINCR_3 0x0C00
+#define DMASRCINCR_0 0x0000
+#define DMASRCINCR_3 0x0300
+#define DMADSTBYTE   0x0080
+#define DMASRCBYTE   0x0040
+#define DMASBDB      0x00C0
+#define DMALEVEL     0x0020
+#define DMAEN        0x0010
+#define DMAIFG       0x0008
+#define DMAIE        0x0004
+#define DMAABORT     0x0002
+#define DMAREQ       0x0001
+
+// Comparator_B
+#define CBIPEN       0x0080
+#define CBOUT        0x0001
+#define CBOUTPOL     0x0002
+#define CBF          0x0004
+#define CBIES        0x0008
+#define CBFDLY_3     0x00C0
+#define CBPWRMD_1    0x0100
+#define CBON         0x0400
+#define CBRSEL       0x0020
+#define CBRS_1       0x0040
+#define CBREF0_31    0x001F
+#define CBREF1_31    0x1F00
+#define CBIFG        0x0001
+#define CBIE         0x0100
+
+/* * INTRÍNSECOS DO COMPILADOR * */
+#define __interrupt
+// Rotinas que o firmware executa da RAM: seção própria para o modelo medir
+#define RAMFUNC __attribute__((section("ramfunc"), noinline, used))
+#define __even_in_range(x, y) (x)
+
+void __bis_SR_register(unsigned int bits);
+void __bic_SR_register(unsigned int bits);
+void __bic_SR_register_on_exit(unsigned int bits);
+void __bis_SR_register_on_exit(unsigned int bits);
+unsigned int __get_SR_register(void);
+void __enable_interrupt(void);
+void __disable_interrupt(void);
+void __delay_cycles(unsigned long cycles);
+void __no_operation(void);
+#define _NOP() __no_operation()
+
+// DMAxSA/DMAxDA guardam endereços que no PC não cabem em 16 bits: o modelo
+// recebe o nome do registrador (texto) e o ponteiro completo
+void sim_data16_write_addr(const char *target, uintptr_t value);
+#define __data16_write_addr(addr, src) sim_data16_write_addr(#addr, (uintptr_t)(src))
+
+#endif
@@ -0,0 +1,1631 @@
+/*
+ * MODELO DE REGISTRADORES EM TEMPO VIRTUAL (MSP430F5529)
+ *
+ * O firmware é compilado no PC contra o msp430.h desta pasta: cada acesso
+ * a registrador passa por sim_reg(), que
+ *   1. aplica os efeitos da escrita anterior (comparando o valor antigo),
+ *   2. avança o tempo virtual pelo custo estimado do acesso,
+ *   3. entrega as interrupções pendentes se GIE estiver ligado.
+ * __bis_SR_register() com bits de LPM avança o tempo direto até o próximo
+ * evento de periférico. Assim uma hora de LPM3 custa alguns eventos, não
+ * uma hora de simulação.
+ *
+ * O modelo cobre apenas o que o ProjetoFinal.c usa: Timer_A/B (up e
+ * contínuo, comparação), ADC12_A (sequências por software), REF_A,
+ * USCI_B0 em I2C mestre com um PCF8574+HD44780 no endereço 0x27,
+ * USCI_A1 em UART (somente transmissão, também via DMA), RTC_A em modo
+ * contador, o controlador de flash (memória de informação e o log na
+ * flash principal), os clocks (UCS com DCO/FLL, XT1 e REFO; níveis do PMM),
+ * as interrupções de borda de P1/P2 (botões), o MPY32 em 16 x 16 bits e o
+ * Comparator_B (pino contra a escada de resistores).
+ *
+ * As ISRs são achadas pelo nome <VETOR>_ISR (ex.: TIMER0_A0_ISR); as que o
+ * firmware não define ficam nulas (símbolos fracos).
+ *
+ * As rotinas marcadas com RAMFUNC ficam na seção ramfunc do executável; o
+ * tempo de CPU gasto nelas (pelo endereço de quem acessa o registrador ou
+ * pela ISR em execução) é somado à parte em ram_cycles.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "sim.h"
+
+typedef unsigned __int128 u128;
+
+// Custo estimado, em ciclos de MCLK, de cada acesso a registrador e da
+// entrada/saída de interrupção
+#define SIM_ACCESS_CYCLES  4
+#define SIM_ISR_ENTRY      6
+#define SIM_ISR_EXIT       5
+
+uint64_t sim_now = 0;
+sim_stats_t sim_stats;
+uint16_t sim_regs[SIM_NREGS];
+FILE *sim_uart_log = 0;
+
+static uint64_t sim_end = SIM_NEVER;
+static unsigned int sim_sr = 0;        // SR do contexto em execução
+static unsigned int sim_exit_bic = 0;  // __bic_SR_register_on_exit da ISR atual
+static unsigned int sim_exit_bis = 0;
+static int sim_isr_depth = 0;
+static int sim_ram = 0;                // Código em execução está na RAM (RAMFUNC)
+
+// Limites da seção ramfunc, criados pelo linker (nulos se ela não existir)
+extern char __start_ramfunc[] __attribute__((weak));
+extern char __stop_ramfunc[] __attribute__((weak));
+
+static int sim_in_ram(const void *pc)
+{
+    return (const char *)pc >= __start_ramfunc && (const char *)pc < __stop_ramfunc;
+}
+
+#define SIM_CALLER() (sim_ram = sim_in_ram(__builtin_return_address(0)))
+static int sim_pending = -1;           // Registrador devolvido no último acesso
+static uint16_t sim_pending_old;
+static int sim_finishing = 0;
+
+static void sim_commit(void);
+static void sim_write_effects(int id, uint16_t old, uint16_t val);
+static void sim_advance_to(uint64_t t);
+static void sim_cpu(uint32_t cycles);
+static int sim_dispatch(void);
+
+/*
+ * CLOCKS (UCS + PMM)
+ */
+
+// O FLL é modelado pelo resultado: o DCO vai direto para a frequência pedida
+// (limitada à faixa do DCORSEL) e DCOFFG fica ligado enquanto o laço trava.
+// O XT1 de 32 kHz do LaunchPad parte depois de XT1_START_PS com os pinos
+// P5.4/P5.5 selecionados; até lá, e sempre que falha, o ACLK e a referência
+// do FLL caem para o REFO (mesma frequência, corrente maior).
+#define REFO_HZ          32768
+#define VLO_HZ           10000
+#define XT1_START_PS     (250 * SIM_PS_PER_S / 1000)
+#define DCO_LOCK_PS      (5 * SIM_PS_PER_S / 1000)
+#define SVSML_DELAY_PS   (2 * SIM_PS_PER_S / 1000000)   // SVSMLDLYIFG após reconfigurar
+#define VCORE_RISE_PS    (30 * SIM_PS_PER_S / 1000000)  // Subida de um nível do Vcore
+
+// Faixa do DCOCLK por DCORSEL (extremos do datasheet)
+static const uint32_t dco_min_hz[8] = {
+    70000, 150000, 320000, 640000, 1300000, 2500000, 4600000, 8500000
+};
+static const uint32_t dco_max_hz[8] = {
+    1700000, 3450000, 7380000, 14000000, 28200000, 54100000, 88000000, 135000000
+};
+
+// Frequência máxima do sistema em cada nível de PMMCOREV
+static const uint32_t vcore_max_hz[4] = { 8000000, 12000000, 20000000, 25000000 };
+
+static uint64_t xt1_ready = SIM_NEVER;  // Instante em que o cristal estabiliza
+static uint64_t dco_locked = 0;         // Fim do travamento do FLL
+static uint64_t svsml_ready = 0;
+static uint64_t vcore_ready = 0;        // Fim da subida para vcore_target
+static int vcore_target = 0;
+static int vcore_from = 0;
+
+static int xt1_requested(void)
+{
+    return !(sim_regs[SIM_UCSCTL6] & XT1OFF) || (sim_regs[SIM_UCSCTL4] & 0x0700) == 0 ||
+           (sim_regs[SIM_UCSCTL3] & 0x0070) == 0;
+}
+
+static int xt1_ok(void)
+{
+    return xt1_requested() && (sim_regs[SIM_P5SEL] & BIT4) && sim_now >= xt1_ready;
+}
+
+static int vcore_level(void)
+{
+    return (sim_now >= vcore_ready) ? vcore_target : vcore_from;
+}
+
+// Divisor D do FLL: DCOCLK = D x DCOCLKDIV
+static uint32_t fll_d(void)
+{
+    int n = (sim_regs[SIM_UCSCTL2] >> 12) & 7;
+    return 1u << (n < 5 ? n : 5);
+}
+
+// DCOCLK pedido ao FLL: fREF / FLLREFDIV x (FLLN + 1) x D
+static uint64_t dco_target_hz(void)
+{
+    static const uint8_t refdiv[8] = { 1, 2, 4, 8, 12, 16, 16, 16 };
+    return (uint64_t)REFO_HZ / refdiv[sim_regs[SIM_UCSCTL3] & 7] *
+           ((sim_regs[SIM_UCSCTL2] & FLLN_MASK) + 1) * fll_d();
+}
+
+static int dco_in_range(void)
+{
+    int rsel = (sim_regs[SIM_UCSCTL1] >> 4) & 7;
+    uint64_t f = dco_target_hz();
+    return f >= dco_min_hz[rsel] && f <= dco_max_hz[rsel];
+}
+
+// DCOCLK (div = 0) ou DCOCLKDIV (div = 1); fora da faixa o DCO satura
+static uint32_t dco_hz(int div)
+{
+    int rsel = (sim_regs[SIM_UCSCTL1] >> 4) & 7;
+    uint64_t f = dco_target_hz();
+    if (f < dco_min_hz[rsel]) f = dco_min_hz[rsel];
+    if (f > dco_max_hz[rsel]) f = dco_max_hz[rsel];
+    return (uint32_t)(div ? f / fll_d() : f);
+}
+
+static uint32_t ucs_source_hz(int sel)
+{
+    switch (sel)
+    {
+    case 1: return VLO_HZ;
+    case 3: return dco_hz(0);
+    case 4: return dco_hz(1);
+    default: return REFO_HZ;  // XT1, REFO e XT2 (ausente, cai para o REFO)
+    }
+}
+
+uint32_t sim_clock_hz(int clk)
+{
+    uint16_t sel = sim_regs[SIM_UCSCTL4], div = sim_regs[SIM_UCSCTL5];
+    int shift = (clk == SIM_ACLK) ? 8 : (clk == SIM_SMCLK) ? 4 : 0;
+    int d = (div >> shift) & 7;
+    return ucs_source_hz((sel >> shift) & 7) >> (d < 5 ? d : 5);
+}
+
+static int sim_clock_on(int clk)
+{
+    if (clk == SIM_MCLK) return !(sim_sr & CPUOFF);
+    if (clk == SIM_SMCLK) return !(sim_sr & SCG1) && !(sim_regs[SIM_UCSCTL6] & SMCLKOFF);
+    return !(sim_sr & OSCOFF);
+}
+
+int sim_cpu_on(void)
+{
+    return !(sim_sr & CPUOFF);
+}
+
+// REFO ligado: fonte do ACLK ou referência do FLL em funcionamento (SCG0 em 0)
+static int refo_on(void)
+{
+    int sela = (sim_regs[SIM_UCSCTL4] >> 8) & 7;
+    int selref = (sim_regs[SIM_UCSCTL3] >> 4) & 7;
+    int aclk = sela == 2 || sela == 5 || (sela == 0 && !xt1_ok());
+    int fll = selref == 2 || selref == 5 || (selref == 0 && !xt1_ok());
+    return (aclk && sim_clock_on(SIM_ACLK)) || (fll && !(sim_sr & SCG0));
+}
+
+// Falhas de oscilador: os flags voltam a ligar enquanto a causa persistir
+static void ucs_faults(void)
+{
+    if (xt1_requested() && !xt1_ok()) sim_regs[SIM_UCSCTL7] |= XT1LFOFFG;
+    if (sim_now < dco_locked || !dco_in_range()) sim_regs[SIM_UCSCTL7] |= DCOFFG;
+    if (sim_regs[SIM_UCSCTL7] & (DCOFFG | XT1LFOFFG | XT2OFFG)) sim_regs[SIM_SFRIFG1] |= OFIFG;
+}
+
+static void pmm_flags(void)
+{
+    if (sim_now >= svsml_ready) sim_regs[SIM_PMMIFG] |= SVSMLDLYIFG;
+    if (sim_now >= vcore_ready && vcore_target > vcore_from) sim_regs[SIM_PMMIFG] |= SVMLVLRIFG;
+}
+
+static void clock_write(int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    if (id >= SIM_UCSCTL0 && id <= SIM_UCSCTL3) dco_locked = sim_now + DCO_LOCK_PS;
+
+    if (id == SIM_UCSCTL3 || id == SIM_UCSCTL4 || id == SIM_UCSCTL6 || id == SIM_P5SEL)
+    {
+        if (!xt1_requested() || !(sim_regs[SIM_P5SEL] & BIT4)) xt1_ready = SIM_NEVER;
+        else if (xt1_ready == SIM_NEVER) xt1_ready = sim_now + XT1_START_PS;
+    }
+
+    if (id == SIM_SVSMLCTL)
+    {
+        sim_regs[SIM_PMMIFG] &= ~SVSMLDLYIFG;
+        svsml_ready = sim_now + SVSML_DELAY_PS;
+    }
+    else if (id == SIM_PMMCTL0)
+    {
+        int level = val & 3, now = vcore_level();
+        if ((val & 0xFF00) != PMMPW)
+        {
+            fprintf(stderr, "sim: PMMCTL0 escrito sem a senha (PUC)\n");
+            exit(2);
+        }
+        if (level > now + 1)
+        {
+            fprintf(stderr, "sim: PMMCOREV subiu mais de um nível de uma vez\n");
+            exit(2);
+        }
+        vcore_from = (level > now) ? now : level;
+        vcore_target = level;
+        vcore_ready = (level > now) ? sim_now + VCORE_RISE_PS : sim_now;
+        if (level > now) sim_regs[SIM_PMMIFG] = (sim_regs[SIM_PMMIFG] & ~SVMLVLRIFG) | SVMLIFG;
+    }
+}
+
+// Número de bordas do clock f ocorridas em [0, t]
+static uint64_t grid_index(uint64_t t, uint32_t f)
+{
+    return (uint64_t)(((u128)t * f) / SIM_PS_PER_S);
+}
+
+// Instante da n-ésima borda do clock f
+static uint64_t grid_time(uint64_t n, uint32_t f)
+{
+    return (uint64_t)(((u128)n * SIM_PS_PER_S + f - 1) / f);
+}
+
+static uint64_t cycles_ps(uint64_t cycles, uint32_t f)
+{
+    return (uint64_t)(((u128)cycles * SIM_PS_PER_S + f - 1) / f);
+}
+
+/*
+ * TIMER_A / TIMER_B
+ */
+
+typedef struct
+{
+    int ctl, r, cctl0, ccr0, ex0, iv, nccr;
+    uint64_t t_last;  // Instante até onde o contador foi atualizado
+    uint32_t phase;   // Bordas de entrada acumuladas para o divisor
+} sim_timer_t;
+
+#define TIMER(n, k) { SIM_##n##CTL, SIM_##n##R, SIM_##n##CCTL0, SIM_##n##CCR0, \
+                      SIM_##n##EX0, SIM_##n##IV, k, 0, 0 }
+static sim_timer_t timers[] = {
+    TIMER(TA0, 5), TIMER(TA1, 3), TIMER(TA2, 3), TIMER(TB0, 7)
+};
+#define NTIMERS (int)(sizeof(timers) / sizeof(timers[0]))
+
+static int timer_clock(const sim_timer_t *t)
+{
+    switch (sim_regs[t->ctl] & TASSEL_3)
+    {
+    case TASSEL_1: return SIM_ACLK;
+    case TASSEL_2: return SIM_SMCLK;
+    default: return -1;  // TACLK/INCLK externos não são modelados
+    }
+}
+
+static uint32_t timer_divider(const sim_timer_t *t)
+{
+    return (1u << ((sim_regs[t->ctl] >> 6) & 3)) * ((sim_regs[t->ex0] & 7) + 1);
+}
+
+static uint16_t timer_top(const sim_timer_t *t)
+{
+    return ((sim_regs[t->ctl] & MC_3) == MC_2) ? 0xFFFF : sim_regs[t->ccr0];
+}
+
+static int timer_running(const sim_timer_t *t)
+{
+    int clk = timer_clock(t);
+    return (sim_regs[t->ctl] & MC_3) != MC_0 && clk >= 0 && sim_clock_on(clk);
+}
+
+// Fração do tempo com a saída TAx.n em 1. O PWM não é simulado borda a
+// borda: em modo up com OUTMOD_7 (Reset/Set) vale CCRn / (CCR0 + 1); parado
+// ou em OUTMOD_0 vale o bit OUT.
+double sim_timer_duty(int timer, int n)
+{
+    const sim_timer_t *t = &timers[timer];
+    uint16_t cctl = sim_regs[t->cctl0 + n];
+
+    if ((cctl & OUTMOD_7) == OUTMOD_0 || !timer_running(t)) return (cctl & OUT) ? 1.0 : 0.0;
+    if ((cctl & OUTMOD_7) == OUTMOD_7 && (sim_regs[t->ctl] & MC_3) == MC_1)
+    {
+        double period = sim_regs[t->ccr0] + 1.0;
+        double ccr = sim_regs[t->ccr0 + n];
+        return ccr >= period ? 1.0 : ccr / period;
+    }
+    return 0.0;  // Outros modos de saída não são usados pelo firmware
+}
+
+// Marca CCIFG dos canais em modo comparação com CCRn em (from, to]
+static void timer_compare(sim_timer_t *t, uint32_t from, uint32_t to)
+{
+    int n;
+    for (n = 0; n < t->nccr; n++)
+    {
+        uint16_t ccr = sim_regs[t->ccr0 + n];
+        if (sim_regs[t->cctl0 + n] & CAP) continue;
+        if (ccr > from && ccr <= to) sim_regs[t->cctl0 + n] |= CCIFG;
+    }
+}
+
+static void timer_advance(sim_timer_t *t, uint64_t now)
+{
+    if (!timer_running(t))
+    {
+        t->t_last = now;
+        return;
+    }
+
+    uint32_t f = sim_clock_hz(timer_clock(t));
+    uint64_t ticks = grid_index(now, f) - grid_index(t->t_last, f);
+    uint32_t div = timer_divider(t);
+    uint64_t counts = (t->phase + ticks) / div;
+    t->phase = (uint32_t)((t->phase + ticks) % div);
+    t->t_last = now;
+
+    uint16_t top = timer_top(t);
+    while (counts)
+    {
+        uint32_t cnt = sim_regs[t->r];
+        uint32_t limit = (cnt <= top) ? top : 0xFFFF;
+        uint32_t to_wrap = limit - cnt + 1;
+        if (counts >= to_wrap)
+        {
+            timer_compare(t, cnt, limit);
+            sim_regs[t->r] = 0;
+            int n;
+            for (n = 0; n < t->nccr; n++)
+                if (!(sim_regs[t->cctl0 + n] & CAP) && sim_regs[t->ccr0 + n] == 0)
+                    sim_regs[t->cctl0 + n] |= CCIFG;
+            sim_regs[t->ctl] |= TAIFG;
+            counts -= to_wrap;
+        }
+        else
+        {
+            timer_compare(t, cnt, cnt + (uint32_t)counts);
+            sim_regs[t->r] = (uint16_t)(cnt + counts);
+            counts = 0;
+        }
+    }
+}
+
+// Próximo instante em que algum CCIFG ou TAIFG muda
+static uint64_t timer_next(const sim_timer_t *t)
+{
+    if (!timer_running(t)) return SIM_NEVER;
+
+    uint32_t cnt = sim_regs[t->r];
+    uint16_t top = timer_top(t);
+    uint32_t limit = (cnt <= top) ? top : 0xFFFF;
+    uint32_t best = limit - cnt + 1;  // Contagens até voltar a 0
+    int n;
+    for (n = 0; n < t->nccr; n++)
+    {
+        uint16_t ccr = sim_regs[t->ccr0 + n];
+        if (sim_regs[t->cctl0 + n] & CAP) continue;
+        if (ccr > cnt && ccr <= limit && ccr - cnt < best) best = ccr - cnt;
+    }
+
+    uint32_t f = sim_clock_hz(timer_clock(t));
+    uint64_t ticks = (uint64_t)best * timer_divider(t) - t->phase;
+    return grid_time(grid_index(t->t_last, f) + ticks, f);
+}
+
+static void timer_write(sim_timer_t *t, int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    if (id == t->ctl && (val & TACLR))
+    {
+        sim_regs[t->r] = 0;
+        t->phase = 0;
+        sim_regs[t->ctl] &= ~TACLR;
+    }
+}
+
+// Leitura de TAxIV: maior prioridade pendente e habilitada, limpa o flag
+static void timer_iv(sim_timer_t *t)
+{
+    int n;
+    for (n = 1; n < t->nccr; n++)
+    {
+        if ((sim_regs[t->cctl0 + n] & (CCIE | CCIFG)) == (CCIE | CCIFG))
+        {
+            sim_regs[t->cctl0 + n] &= ~CCIFG;
+            sim_regs[t->iv] = 2 * n;
+            return;
+        }
+    }
+    if ((sim_regs[t->ctl] & (TAIE | TAIFG)) == (TAIE | TAIFG))
+    {
+        sim_regs[t->ctl] &= ~TAIFG;
+        sim_regs[t->iv] = 14;
+        return;
+    }
+    sim_regs[t->iv] = 0;
+}
+
+static int timer_pending0(const sim_timer_t *t)
+{
+    return (sim_regs[t->cctl0] & (CCIE | CCIFG)) == (CCIE | CCIFG);
+}
+
+static int timer_pending1(const sim_timer_t *t)
+{
+    int n;
+    for (n = 1; n < t->nccr; n++)
+        if ((sim_regs[t->cctl0 + n] & (CCIE | CCIFG)) == (CCIE | CCIFG)) return 1;
+    return (sim_regs[t->ctl] & (TAIE | TAIFG)) == (TAIE | TAIFG);
+}
+
+/*
+ * RTC_A EM MODO CONTADOR
+ */
+
+// Só a entrada direta de ACLK é modelada (RTCSSEL_0); os prescalers
+// RT0PS/RT1PS não alimentam o contador aqui.
+static uint32_t rtc_count = 0;
+static uint64_t rtc_t_last = 0;
+
+static int rtc_running(void)
+{
+    uint16_t ctl = sim_regs[SIM_RTCCTL01];
+    return !(ctl & (RTCHOLD | RTCMODE)) && (ctl & RTCSSEL_3) == RTCSSEL_0 &&
+           sim_clock_on(SIM_ACLK);
+}
+
+// Contagens até o estouro selecionado por RTCTEV (8, 16, 24 ou 32 bits)
+static uint64_t rtc_to_event(void)
+{
+    int bits = 8 * (((sim_regs[SIM_RTCCTL01] >> 8) & 3) + 1);
+    uint64_t span = 1ULL << bits;
+    return span - (rtc_count & (span - 1));
+}
+
+static void rtc_advance(uint64_t now)
+{
+    if (rtc_running())
+    {
+        uint64_t ticks = grid_index(now, sim_clock_hz(SIM_ACLK)) -
+                         grid_index(rtc_t_last, sim_clock_hz(SIM_ACLK));
+        if (ticks >= rtc_to_event()) sim_regs[SIM_RTCCTL01] |= RTCTEVIFG;
+        rtc_count += (uint32_t)ticks;
+    }
+    rtc_t_last = now;
+    sim_regs[SIM_RTCNT12] = (uint16_t)rtc_count;
+    sim_regs[SIM_RTCNT34] = (uint16_t)(rtc_count >> 16);
+}
+
+static uint64_t rtc_next(void)
+{
+    if (!rtc_running()) return SIM_NEVER;
+    uint32_t f = sim_clock_hz(SIM_ACLK);
+    return grid_time(grid_index(rtc_t_last, f) + rtc_to_event(), f);
+}
+
+static void rtc_write(int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    (void)val;
+    if (id == SIM_RTCNT12 || id == SIM_RTCNT34)
+        rtc_count = sim_regs[SIM_RTCNT12] | ((uint32_t)sim_regs[SIM_RTCNT34] << 16);
+}
+
+// Leitura de RTCIV: maior prioridade pendente e habilitada, limpa o flag
+static void rtc_iv(void)
+{
+    uint16_t ctl = sim_regs[SIM_RTCCTL01];
+    if ((ctl & RTCRDYIE) && (ctl & RTCRDYIFG)) { ctl &= ~RTCRDYIFG; sim_regs[SIM_RTCIV] = 2; }
+    else if ((ctl & RTCTEVIE) && (ctl & RTCTEVIFG)) { ctl &= ~RTCTEVIFG; sim_regs[SIM_RTCIV] = 4; }
+    else if ((ctl & RTCAIE) && (ctl & RTCAIFG)) { ctl &= ~RTCAIFG; sim_regs[SIM_RTCIV] = 6; }
+    else sim_regs[SIM_RTCIV] = 0;
+    sim_regs[SIM_RTCCTL01] = ctl;
+}
+
+static int rtc_pending(void)
+{
+    uint16_t ctl = sim_regs[SIM_RTCCTL01];
+    return (ctl & (ctl << 4) & (RTCTEVIE | RTCAIE | RTCRDYIE)) != 0;
+}
+
+/*
+ * PCF8574 + HD44780 (LCD 16x2 no endereço 0x27)
+ */
+
+#define PCF_RS  BIT0
+#define PCF_EN  BIT2
+#define PCF_BL  BIT3
+
+static uint8_t pcf_out = 0xFF;  // Saídas quase-bidirecionais sobem no reset
+static int pcf_powerup = 1;     // A primeira escrita sai do estado de reset
+static uint8_t lcd_ddram[0x68];
+static uint8_t lcd_ac = 0;
+static int lcd_8bit = 1;
+static int lcd_half = 0;        // Primeiro nibble já recebido (modo 4 bits)
+static uint8_t lcd_hi = 0;
+static int lcd_fset_count = 0;
+static uint64_t lcd_busy_until = 15 * 1000000000ULL;  // 15 ms após ligar
+
+uint8_t sim_pcf8574(void)
+{
+    return pcf_out;
+}
+
+void sim_lcd_line(int row, char *out)
+{
+    int i;
+    for (i = 0; i < 16; i++)
+    {
+        uint8_t c = lcd_ddram[(row ? 0x40 : 0x00) + i];
+        out[i] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+    }
+    out[16] = '\0';
+}
+
+static void lcd_ac_step(void)
+{
+    lcd_ac++;
+    if (lcd_ac == 0x28) lcd_ac = 0x40;
+    else if (lcd_ac >= 0x68) lcd_ac = 0x00;
+}
+
+static void lcd_exec(uint8_t v, int rs)
+{
+    uint64_t busy = 37000000ULL;  // 37 us
+    sim_stats.lcd_instructions++;
+
+    if (rs)
+    {
+        if (lcd_ac < sizeof(lcd_ddram)) lcd_ddram[lcd_ac] = v;
+        lcd_ac_step();
+        busy = 41000000ULL;
+    }
+    else if (v & 0x80) lcd_ac = v & 0x7F;
+    else if (v & 0x40) { /* Endereço de CGRAM: não modelado */ }
+    else if (v & 0x20)
+    {
+        // Inicialização por instrução: 4,1 ms após o primeiro 0x3x e
+        // 100 us após o segundo
+        if (lcd_8bit && lcd_fset_count == 0) busy = 4100000000ULL;
+        else if (lcd_8bit && lcd_fset_count == 1) busy = 100000000ULL;
+        lcd_fset_count++;
+        lcd_8bit = (v & 0x10) != 0;
+        lcd_half = 0;
+    }
+    else if (v & 0x08 || v & 0x04) { /* Display/entrada: só o tempo */ }
+    else if (v & 0x02) { lcd_ac = 0; busy = 1520000000ULL; }
+    else if (v & 0x01)
+    {
+        memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+        lcd_ac = 0;
+        busy = 1520000000ULL;
+    }
+    lcd_busy_until = sim_now + busy;
+}
+
+static void lcd_nibble(uint8_t data, int rs)
+{
+    if (sim_now < lcd_busy_until) sim_stats.lcd_violations++;
+
+    if (lcd_8bit)
+    {
+        lcd_exec(data & 0xF0, rs);
+        return;
+    }
+    if (!lcd_half)
+    {
+        lcd_hi = data & 0xF0;
+        lcd_half = 1;
+        return;
+    }
+    lcd_half = 0;
+    lcd_exec(lcd_hi | (data >> 4), rs);
+}
+
+static void pcf_write(uint8_t v)
+{
+    // Subida do EN com RS mudando ao mesmo tempo viola tAS
+    if (!(pcf_out & PCF_EN) && (v & PCF_EN) && ((v ^ pcf_out) & PCF_RS))
+        sim_stats.lcd_violations++;
+
+    // Descida do EN: o LCD amostra D7..D4 e RS, que não podem mudar junto
+    if ((pcf_out & PCF_EN) && !(v & PCF_EN))
+    {
+        // A descida a partir do estado de reset (EN alto) é inevitável e
+        // não depende do firmware
+        if (((v ^ pcf_out) & (0xF0 | PCF_RS)) && !pcf_powerup) sim_stats.lcd_violations++;
+        lcd_nibble(pcf_out & 0xF0, pcf_out & PCF_RS);
+    }
+    pcf_out = v;
+    pcf_powerup = 0;
+}
+
+/*
+ * USCI_B0 EM I2C MESTRE (transmissão)
+ */
+
+enum { I2C_IDLE, I2C_ADDR, I2C_DATA, I2C_STOP, I2C_HOLD };
+
+static int i2c_phase = I2C_IDLE;
+static uint64_t i2c_t_end = 0;
+static int i2c_buf_full = 0;
+static uint8_t i2c_buf = 0;
+static uint8_t i2c_shift = 0;
+static int i2c_acked = 0;
+
+static uint64_t i2c_bit_ps(void)
+{
+    uint32_t br = sim_regs[SIM_UCB0BR0] | (sim_regs[SIM_UCB0BR1] << 8);
+    if (br == 0) br = 1;
+    return cycles_ps(br, sim_clock_hz(SIM_SMCLK));
+}
+
+static void i2c_start(void)
+{
+    sim_stats.i2c_starts++;
+    sim_stats.i2c_bytes++;
+    sim_regs[SIM_UCB0STAT] |= UCBBUSY;
+    if (sim_regs[SIM_UCB0CTL1] & UCTR) sim_regs[SIM_UCB0IFG] |= UCTXIFG;
+    i2c_phase = I2C_ADDR;
+    i2c_t_end = sim_now + 10 * i2c_bit_ps();  // START + 7 bits + R/W + ACK
+}
+
+// Decide o próximo passo quando o deslocador fica livre
+static void i2c_next(void)
+{
+    uint16_t ctl1 = sim_regs[SIM_UCB0CTL1];
+    if (i2c_buf_full && i2c_acked)
+    {
+        i2c_shift = i2c_buf;
+        i2c_buf_full = 0;
+        sim_regs[SIM_UCB0IFG] |= UCTXIFG;
+        sim_stats.i2c_bytes++;
+        i2c_phase = I2C_DATA;
+        i2c_t_end = sim_now + 9 * i2c_bit_ps();
+    }
+    else if (ctl1 & UCTXSTP)
+    {
+        i2c_phase = I2C_STOP;
+        i2c_t_end = sim_now + i2c_bit_ps();
+    }
+    else if (ctl1 & UCTXSTT)
+    {
+        i2c_start();  // START repetido
+    }
+    else
+    {
+        i2c_phase = I2C_HOLD;  // SCL seguro em baixo até o firmware agir
+    }
+}
+
+static void i2c_process(void)
+{
+    while (i2c_phase != I2C_IDLE && i2c_phase != I2C_HOLD && i2c_t_end <= sim_now)
+    {
+        switch (i2c_phase)
+        {
+        case I2C_ADDR:
+            sim_regs[SIM_UCB0CTL1] &= ~UCTXSTT;
+            i2c_acked = (sim_regs[SIM_UCB0I2CSA] & 0x7F) == 0x27;
+            if (!i2c_acked)
+            {
+                sim_stats.i2c_nacks++;
+                sim_regs[SIM_UCB0IFG] |= UCNACKIFG;
+                i2c_buf_full = 0;
+            }
+            i2c_next();
+            break;
+        case I2C_DATA:
+            pcf_write(i2c_shift);
+            i2c_next();
+            break;
+        case I2C_STOP:
+            sim_regs[SIM_UCB0CTL1] &= ~UCTXSTP;
+            sim_regs[SIM_UCB0STAT] &= ~UCBBUSY;
+            i2c_phase = I2C_IDLE;
+            if (sim_regs[SIM_UCB0CTL1] & UCTXSTT) i2c_start();
+            break;
+        }
+    }
+}
+
+static void i2c_write(int id, uint16_t old, uint16_t val)
+{
+    if (id == SIM_UCB0CTL1)
+    {
+        if (val & UCSWRST)
+        {
+            i2c_phase = I2C_IDLE;
+            i2c_buf_full = 0;
+            sim_regs[SIM_UCB0IFG] = 0;
+            sim_regs[SIM_UCB0STAT] &= ~UCBBUSY;
+            return;
+        }
+        if (!(sim_regs[SIM_UCB0CTL0] & UCMST)) return;
+        if (i2c_phase == I2C_IDLE && (val & UCTXSTT) && !(old & UCTXSTT)) i2c_start();
+        else if (i2c_phase == I2C_HOLD && (val & (UCTXSTT | UCTXSTP))) i2c_next();
+    }
+    else if (id == SIM_UCB0TXBUF && val != 0xFFFF)
+    {
+        i2c_buf = (uint8_t)val;
+        i2c_buf_full = 1;
+        sim_regs[SIM_UCB0IFG] &= ~UCTXIFG;
+        if (i2c_phase == I2C_HOLD) i2c_next();
+    }
+}
+
+static void i2c_iv(void)
+{
+    static const uint16_t order[] = { UCALIFG, UCNACKIFG, UCSTTIFG, UCSTPIFG, UCRXIFG, UCTXIFG };
+    uint16_t active = sim_regs[SIM_UCB0IFG] & sim_regs[SIM_UCB0IE];
+    int i;
+    for (i = 0; i < 6; i++)
+    {
+        if (active & order[i])
+        {
+            sim_regs[SIM_UCB0IFG] &= ~order[i];
+            sim_regs[SIM_UCB0IV] = 2 * (i + 1);
+            return;
+        }
+    }
+    sim_regs[SIM_UCB0IV] = 0;
+}
+
+/*
+ * USCI_A1 EM UART (transmissão)
+ */
+
+static int uart_busy = 0;
+static uint64_t uart_t_end = 0;
+static int uart_buf_full = 0;
+static uint8_t uart_buf = 0;
+
+static int uart_clock(void)
+{
+    return (sim_regs[SIM_UCA1CTL1] & UCSSEL_3) == UCSSEL__ACLK ? SIM_ACLK : SIM_SMCLK;
+}
+
+// START + 8 + STOP; a modulação UCBRS soma UCBRS/8 de ciclo por bit
+static uint64_t uart_byte_ps(void)
+{
+    uint32_t br = sim_regs[SIM_UCA1BR0] | (sim_regs[SIM_UCA1BR1] << 8);
+    uint32_t brs = (sim_regs[SIM_UCA1MCTL] >> 1) & 7;
+    if (sim_regs[SIM_UCA1MCTL] & UCOS16) return cycles_ps(160ULL * (br ? br : 1),
+                                                          sim_clock_hz(uart_clock()));
+    return cycles_ps(10ULL * (8 * (br ? br : 1) + brs), sim_clock_hz(uart_clock())) / 8;
+}
+
+static void uart_shift(void)
+{
+    uint8_t b = uart_buf;
+    uart_buf_full = 0;
+    uart_busy = 1;
+    uart_t_end = sim_now + uart_byte_ps();
+    sim_regs[SIM_UCA1IFG] |= UCTXIFG;
+    sim_regs[SIM_UCA1STAT] |= UCBUSY;
+    sim_stats.uart_bytes++;
+    if (sim_uart_log) fputc(b, sim_uart_log);
+}
+
+static void uart_process(void)
+{
+    if (uart_busy && uart_t_end <= sim_now)
+    {
+        uart_busy = 0;
+        sim_regs[SIM_UCA1STAT] &= ~UCBUSY;
+        if (uart_buf_full) uart_shift();
+    }
+}
+
+static void uart_write(int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    if (id == SIM_UCA1CTL1 && (val & UCSWRST))
+    {
+        uart_busy = 0;
+        uart_buf_full = 0;
+        sim_regs[SIM_UCA1IFG] = UCTXIFG;
+    }
+    else if (id == SIM_UCA1TXBUF && val != 0xFFFF)
+    {
+        uart_buf = (uint8_t)val;
+        uart_buf_full = 1;
+        sim_regs[SIM_UCA1IFG] &= ~UCTXIFG;
+        if (!uart_busy) uart_shift();
+    }
+}
+
+static void uart_iv(void)
+{
+    uint16_t active = sim_regs[SIM_UCA1IFG] & sim_regs[SIM_UCA1IE];
+    if (active & UCRXIFG) { sim_regs[SIM_UCA1IFG] &= ~UCRXIFG; sim_regs[SIM_UCA1IV] = 2; }
+    else if (active & UCTXIFG) { sim_regs[SIM_UCA1IFG] &= ~UCTXIFG; sim_regs[SIM_UCA1IV] = 4; }
+    else sim_regs[SIM_UCA1IV] = 0;
+}
+
+/*
+ * DMA (canal 0)
+ */
+
+// Só o que a telemetria usa: transferência única (DMADT_0), disparada pela
+// borda de subida de UCA1TXIFG. Os 2 ciclos de MCLK que cada transferência
+// pede em LPM3 não entram na contabilidade.
+static uintptr_t dma_sa = 0, dma_da = 0;
+static uint16_t dma_done = 0;       // Transferências do bloco atual
+static int dma_trigger_level = 1;   // UCTXIFG na última verificação
+
+void sim_data16_write_addr(const char *target, uintptr_t value)
+{
+    sim_commit();
+    if (strstr(target, "DMA0SA")) dma_sa = value;
+    else if (strstr(target, "DMA0DA")) dma_da = value;
+}
+
+static void dma_transfer(void)
+{
+    uint16_t ctl = sim_regs[SIM_DMA0CTL];
+    uintptr_t src = dma_sa + (((ctl >> 8) & 3) == 3 ? dma_done : 0);
+    uintptr_t dst = dma_da + (((ctl >> 10) & 3) == 3 ? dma_done : 0);
+    uint8_t b = *(uint8_t *)src;
+    uintptr_t regs = (uintptr_t)sim_regs;
+
+    if (dst - regs < sizeof(sim_regs))
+    {
+        int id = (int)((dst - regs) / sizeof(sim_regs[0]));
+        uint16_t old = sim_regs[id];
+        sim_regs[id] = b;
+        sim_write_effects(id, old, b);
+        // Escrever no UCA1TXBUF zera UCTXIFG: se a UART já passou o byte
+        // para o registrador de deslocamento, o flag voltou em 1 (nova borda)
+        if (id == SIM_UCA1TXBUF) dma_trigger_level = 0;
+    }
+    else *(uint8_t *)dst = b;
+    sim_stats.dma_transfers++;
+
+    if (++dma_done >= sim_regs[SIM_DMA0SZ])
+    {
+        dma_done = 0;
+        sim_regs[SIM_DMA0CTL] = (ctl & ~DMAEN) | DMAIFG;
+    }
+}
+
+static void dma_service(void)
+{
+    for (;;)
+    {
+        int level = (sim_regs[SIM_UCA1IFG] & UCTXIFG) != 0;
+        int edge = level && !dma_trigger_level;
+        dma_trigger_level = level;
+        if (!edge || !(sim_regs[SIM_DMA0CTL] & DMAEN)) return;
+        if ((sim_regs[SIM_DMACTL0] & 0x1F) != DMA0TSEL__UCA1TXIFG) return;
+        dma_transfer();
+    }
+}
+
+static void dma_write(int id, uint16_t old, uint16_t val)
+{
+    if (id == SIM_DMA0CTL && (val & DMAEN) && !(old & DMAEN)) dma_done = 0;
+}
+
+static void dma_iv(void)
+{
+    uint16_t ctl = sim_regs[SIM_DMA0CTL];
+    if ((ctl & DMAIFG) && (ctl & DMAIE))
+    {
+        sim_regs[SIM_DMA0CTL] &= ~DMAIFG;
+        sim_regs[SIM_DMAIV] = 2;
+    }
+    else sim_regs[SIM_DMAIV] = 0;
+}
+
+/*
+ * ADC12_A + REF_A
+ */
+
+static int adc_busy = 0;
+static int adc_slot = 0;
+static uint64_t adc_t_end = 0;
+static int adc_clk = -1;  // Clock do ADC12CLK (-1 = MODOSC, sempre ligado)
+
+static const uint16_t adc_sht[16] = {
+    4, 8, 16, 32, 64, 96, 128, 192, 256, 384, 512, 768, 768, 768, 768, 768
+};
+
+static int ref_on(void)
+{
+    if (sim_regs[SIM_REFCTL0] & REFMSTR) return (sim_regs[SIM_REFCTL0] & REFON) != 0;
+    return (sim_regs[SIM_ADC12CTL0] & ADC12REFON) != 0;
+}
+
+static double ref_volts(void)
+{
+    if (sim_regs[SIM_REFCTL0] & REFMSTR)
+    {
+        switch (sim_regs[SIM_REFCTL0] & REFVSEL_3)
+        {
+        case REFVSEL_0: return 1.5;
+        case REFVSEL_1: return 2.0;
+        default: return 2.5;
+        }
+    }
+    return (sim_regs[SIM_ADC12CTL0] & ADC12REF2_5V) ? 2.5 : 1.5;
+}
+
+static uint64_t adc_slot_ps(int slot)
+{
+    uint16_t ctl0 = sim_regs[SIM_ADC12CTL0];
+    uint16_t ctl1 = sim_regs[SIM_ADC12CTL1];
+    uint16_t sht = adc_sht[(slot < 8 ? ctl0 >> 8 : ctl0 >> 12) & 0xF];
+    uint16_t conv = 9 + 2 * ((sim_regs[SIM_ADC12CTL2] >> 4) & 3);
+    uint32_t div = (((ctl1 >> 5) & 7) + 1) * ((sim_regs[SIM_ADC12CTL2] & ADC12PDIV) ? 4 : 1);
+    uint32_t f;
+
+    switch ((ctl1 >> 3) & 3)
+    {
+    case 1: adc_clk = SIM_ACLK; break;
+    case 2: adc_clk = SIM_MCLK; break;
+    case 3: adc_clk = SIM_SMCLK; break;
+    default: adc_clk = -1; break;
+    }
+    f = (adc_clk < 0) ? 4800000 : sim_clock_hz(adc_clk);
+    return cycles_ps((uint64_t)(sht + conv + 1) * div, f);
+}
+
+static uint16_t adc_sample(int slot)
+{
+    uint8_t mctl = (uint8_t)sim_regs[SIM_ADC12MCTL0 + slot];
+    int inch = mctl & 0x0F;
+    int bits = 8 + 2 * ((sim_regs[SIM_ADC12CTL2] >> 4) & 3);
+    double vref, v;
+
+    if (((mctl >> 4) & 7) == 0) vref = bench_avcc();
+    else vref = ref_on() ? ref_volts() : 0.0;
+
+    if (inch == 11) v = bench_avcc() / 2.0;      // (AVCC - AVSS) / 2
+    else if (inch == 10) v = 0.7;                // Sensor de temperatura
+    else v = bench_analog(inch);
+
+    sim_stats.adc_conversions++;
+    if (vref <= 0.0) return 0;
+    double code = v / vref * (double)(1 << bits);
+    if (code < 0.0) code = 0.0;
+    if (code > (double)((1 << bits) - 1)) code = (double)((1 << bits) - 1);
+    return (uint16_t)code;
+}
+
+static void adc_process(void)
+{
+    while (adc_busy && adc_t_end <= sim_now)
+    {
+        uint16_t ctl1 = sim_regs[SIM_ADC12CTL1];
+        int conseq = (ctl1 >> 1) & 3;
+        uint8_t mctl = (uint8_t)sim_regs[SIM_ADC12MCTL0 + adc_slot];
+
+        sim_regs[SIM_ADC12MEM0 + adc_slot] = adc_sample(adc_slot);
+        sim_regs[SIM_ADC12IFG] |= 1u << adc_slot;
+
+        int more = (conseq == 1 || conseq == 3) && !(mctl & ADC12EOS);
+        if (more && (sim_regs[SIM_ADC12CTL0] & ADC12MSC))
+        {
+            adc_slot = (adc_slot + 1) & 15;
+            adc_t_end = sim_now + adc_slot_ps(adc_slot);
+        }
+        else
+        {
+            adc_busy = 0;
+            sim_regs[SIM_ADC12CTL1] &= ~ADC12BUSY;
+        }
+    }
+}
+
+static void adc_write(int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    if (id != SIM_ADC12CTL0) return;
+    if ((val & ADC12SC) && (val & ADC12ENC) && (val & ADC12ON) && !adc_busy)
+    {
+        adc_busy = 1;
+        adc_slot = (sim_regs[SIM_ADC12CTL1] >> 12) & 15;
+        adc_t_end = sim_now + adc_slot_ps(adc_slot);
+        sim_regs[SIM_ADC12CTL1] |= ADC12BUSY;
+    }
+    sim_regs[SIM_ADC12CTL0] &= ~ADC12SC;  // Reset automático
+    if (!(val & ADC12ON))
+    {
+        adc_busy = 0;
+        sim_regs[SIM_ADC12CTL1] &= ~ADC12BUSY;
+    }
+}
+
+static void adc_iv(void)
+{
+    uint16_t active = sim_regs[SIM_ADC12IFG] & sim_regs[SIM_ADC12IE];
+    int x;
+    for (x = 0; x < 16; x++)
+    {
+        if (active & (1u << x))
+        {
+            sim_regs[SIM_ADC12IFG] &= ~(1u << x);
+            sim_regs[SIM_ADC12IV] = 6 + 2 * x;
+            return;
+        }
+    }
+    sim_regs[SIM_ADC12IV] = 0;
+}
+
+/*
+ * CONTROLADOR DE FLASH
+ */
+
+// A gravação é tratada como escrita de RAM (não há como interceptar os
+// acessos à memória); o apagamento vem pela escrita fictícia, que o
+// firmware faz via FLASH_DUMMY_WRITE, e enche o segmento com 0xFF. Vetores
+// fora de sim_info_mem são da flash principal, alinhados em 512 bytes.
+#define FLASH_ERASE_PS  23000000000ULL  // tSEG_ERASE típico
+#define FLASH_WORD_PS   64000000ULL     // tWORD típico
+
+uint8_t sim_info_mem[512] = { [0 ... 511] = 0xFF };
+
+static uint64_t flash_busy_until = 0;
+static int flash_armed = 0;  // Próxima espera por BUSY segue uma palavra gravada
+
+static void flash_write(int id, uint16_t old, uint16_t val)
+{
+    (void)old;
+    if (id != SIM_FCTL1 || (val & 0xFF00) != FWKEY) return;
+    flash_armed = (val & WRT) != 0;
+}
+
+void sim_flash_dummy_write(volatile void *p)
+{
+    uint8_t *addr = (uint8_t *)p;
+    uintptr_t info = (uintptr_t)sim_info_mem;
+
+    sim_commit();  // Aplica a escrita em FCTL1 que precede a fictícia
+    if (!(sim_regs[SIM_FCTL1] & ERASE) || (sim_regs[SIM_FCTL3] & LOCK))
+    {
+        memset(addr, 0, 2);
+        return;
+    }
+    if ((uintptr_t)addr - info < sizeof(sim_info_mem))
+        memset(sim_info_mem + ((uintptr_t)addr - info) / 128 * 128, 0xFF, 128);
+    else
+        memset((uint8_t *)((uintptr_t)addr & ~(uintptr_t)511), 0xFF, 512);
+    flash_busy_until = sim_now + FLASH_ERASE_PS;
+    sim_stats.flash_erases++;
+}
+
+// Leitura de FCTL3: cada espera por BUSY em modo WRT corresponde a uma palavra
+static void flash_poll(void)
+{
+    if ((sim_regs[SIM_FCTL1] & WRT) && flash_armed && sim_now >= flash_busy_until)
+    {
+        flash_busy_until = sim_now + FLASH_WORD_PS;
+        flash_armed = 0;
+        sim_stats.flash_words++;
+    }
+    if (sim_now < flash_busy_until) sim_regs[SIM_FCTL3] |= BUSY;
+    else
+    {
+        sim_regs[SIM_FCTL3] &= ~BUSY;
+        if (sim_regs[SIM_FCTL1] & WRT) flash_armed = 1;
+    }
+}
+
+/*
+ * MULTIPLICADOR (MPY32, 16 x 16 bits)
+ */
+
+// A escrita no primeiro operando escolhe a operação (MPY, MPYS, MAC, MACS)
+// e a escrita em OP2 dispara. MAC/MACS somam o produto ao que está em
+// RESHI:RESLO, que o firmware pode pré-carregar. SUMEXT recebe a extensão
+// de sinal (MPYS/MACS) ou o vai-um (MAC). Como o modelo não distingue
+// leitura de escrita, todo acesso a OP2 dispara, mesmo repetindo o valor
+// anterior: o firmware só escreve nos operandos.
+static int mpy_op = SIM_MPY;
+
+static int mpy_write(int id)
+{
+    if (id == SIM_MPY || id == SIM_MPYS || id == SIM_MAC || id == SIM_MACS)
+    {
+        mpy_op = id;
+        return 1;
+    }
+    if (id != SIM_OP2) return 0;
+
+    uint16_t op1 = sim_regs[mpy_op], op2 = sim_regs[SIM_OP2];
+    int sign = (mpy_op == SIM_MPYS || mpy_op == SIM_MACS);
+    uint64_t acc = 0, prod;
+
+    if (mpy_op == SIM_MAC || mpy_op == SIM_MACS)
+        acc = ((uint32_t)sim_regs[SIM_RESHI] << 16) | sim_regs[SIM_RESLO];
+    if (sign) prod = (uint32_t)((int32_t)(int16_t)op1 * (int16_t)op2);
+    else prod = (uint32_t)op1 * op2;
+
+    uint64_t sum = acc + prod;
+    uint32_t res = (uint32_t)sum;
+    sim_regs[SIM_RESLO] = (uint16_t)res;
+    sim_regs[SIM_RESHI] = (uint16_t)(res >> 16);
+    if (sign) sim_regs[SIM_SUMEXT] = (res & 0x80000000u) ? 0xFFFF : 0;
+    else sim_regs[SIM_SUMEXT] = (mpy_op == SIM_MAC && (sum >> 32)) ? 1 : 0;
+    return 1;
+}
+
+/*
+ * COMPARATOR_B
+ */
+
+// Pino CBx (CBIPEN) contra a escada de resistores sobre Vcc (CBRS_1), do
+// lado escolhido por CBRSEL. A escada usa CBREF0 com a saída em 0 e CBREF1
+// com ela em 1. A saída é reavaliada a cada escrita e a cada avanço do
+// tempo com o comparador ligado; a borda de CBIES liga o CBIFG. O filtro
+// (CBF) não é modelado.
+static void comp_update(void)
+{
+    uint16_t ctl0 = sim_regs[SIM_CBCTL0], ctl1 = sim_regs[SIM_CBCTL1];
+    uint16_t ctl2 = sim_regs[SIM_CBCTL2];
+
+    if (!(ctl1 & CBON)) return;
+
+    int out = ctl1 & CBOUT;
+    int tap = out ? (ctl2 >> 8) & 31 : ctl2 & 31;
+    double vref = ((ctl2 >> 6) & 3) == 1 ? bench_avcc() * (tap + 1) / 32.0 : 0.0;
+    double vin = (ctl0 & CBIPEN) ? bench_analog(ctl0 & 0x0F) : 0.0;
+    double vp = (ctl2 & CBRSEL) ? vin : vref;
+    double vm = (ctl2 & CBRSEL) ? vref : vin;
+    int now = (vp > vm) != ((ctl1 & CBOUTPOL) != 0);
+
+    if (now == out) return;
+    sim_regs[SIM_CBCTL1] ^= CBOUT;
+    if (now != ((ctl1 & CBIES) != 0)) sim_regs[SIM_CBINT] |= CBIFG;
+}
+
+static void comp_write(int id, uint16_t old, uint16_t val)
+{
+    if (id == SIM_CBCTL1 && !(val & CBON)) sim_regs[SIM_CBCTL1] &= ~CBOUT;
+    if (id == SIM_CBCTL0 || id == SIM_CBCTL1 || id == SIM_CBCTL2) comp_update();
+}
+
+static void comp_iv(void)
+{
+    if (sim_regs[SIM_CBINT] & CBIFG & (sim_regs[SIM_CBINT] >> 8))
+    {
+        sim_regs[SIM_CBINT] &= ~CBIFG;
+        sim_regs[SIM_CBIV] = 2;
+    }
+    else sim_regs[SIM_CBIV] = 0;
+}
+
+/*
+ * INTERRUPÇÕES DE PORTA (P1/P2)
+ */
+
+static const int port_in[2] = { SIM_P1IN, SIM_P2IN };
+static const int port_ies[2] = { SIM_P1IES, SIM_P2IES };
+static const int port_ie[2] = { SIM_P1IE, SIM_P2IE };
+static const int port_ifg[2] = { SIM_P1IFG, SIM_P2IFG };
+static const int port_iv[2] = { SIM_P1IV, SIM_P2IV };
+
+// O cenário muda o nível dos pinos 'mask'; a borda escolhida por PxIES
+// (1 = descida) liga o PxIFG
+void sim_port_in(int port, uint8_t mask, int level)
+{
+    int p = port - 1;
+    uint16_t old = sim_regs[port_in[p]];
+    uint16_t val = level ? (old | mask) : (old & ~mask);
+    uint16_t fall = old & ~val, rise = val & ~old;
+    uint16_t ies = sim_regs[port_ies[p]];
+
+    sim_regs[port_in[p]] = val;
+    sim_regs[port_ifg[p]] |= (fall & ies) | (rise & ~ies);
+}
+
+// PxIV: o flag habilitado de menor número, que a leitura limpa
+static void port_iv_read(int p)
+{
+    uint16_t pend = sim_regs[port_ifg[p]] & sim_regs[port_ie[p]] & 0xFF;
+    int bit;
+
+    sim_regs[port_iv[p]] = 0;
+    for (bit = 0; bit < 8; bit++)
+    {
+        if (pend & (1u << bit))
+        {
+            sim_regs[port_iv[p]] = 2 * (bit + 1);
+            sim_regs[port_ifg[p]] &= ~(1u << bit);
+            return;
+        }
+    }
+}
+
+/*
+ * VETORES DE INTERRUPÇÃO
+ */
+
+#define ISR(n) extern void n##_ISR(void) __attribute__((weak));
+ISR(COMP_B) ISR(TIMER0_B0) ISR(TIMER0_B1) ISR(USCI_B0) ISR(ADC12) ISR(TIMER0_A0)
+ISR(TIMER0_A1) ISR(DMA) ISR(TIMER1_A0) ISR(TIMER1_A1) ISR(USCI_A1) ISR(TIMER2_A0)
+ISR(TIMER2_A1) ISR(RTC) ISR(PORT1) ISR(PORT2)
+#undef ISR
+
+static int pend_ta0_0(void) { return timer_pending0(&timers[0]); }
+static int pend_ta0_1(void) { return timer_pending1(&timers[0]); }
+static int pend_ta1_0(void) { return timer_pending0(&timers[1]); }
+static int pend_ta1_1(void) { return timer_pending1(&timers[1]); }
+static int pend_ta2_0(void) { return timer_pending0(&timers[2]); }
+static int pend_ta2_1(void) { return timer_pending1(&timers[2]); }
+static int pend_tb0_0(void) { return timer_pending0(&timers[3]); }
+static int pend_tb0_1(void) { return timer_pending1(&timers[3]); }
+static int pend_ucb0(void) { return (sim_regs[SIM_UCB0IFG] & sim_regs[SIM_UCB0IE]) != 0; }
+static int pend_uca1(void) { return (sim_regs[SIM_UCA1IFG] & sim_regs[SIM_UCA1IE]) != 0; }
+static int pend_dma(void) { return (sim_regs[SIM_DMA0CTL] & (DMAIFG | DMAIE)) == (DMAIFG | DMAIE); }
+static int pend_adc12(void) { return (sim_regs[SIM_ADC12IFG] & sim_regs[SIM_ADC12IE]) != 0; }
+static int pend_port1(void) { return (sim_regs[SIM_P1IFG] & sim_regs[SIM_P1IE] & 0xFF) != 0; }
+static int pend_port2(void) { return (sim_regs[SIM_P2IFG] & sim_regs[SIM_P2IE] & 0xFF) != 0; }
+static int pend_comp_b(void) { return (sim_regs[SIM_CBINT] & CBIFG & (sim_regs[SIM_CBINT] >> 8)) != 0; }
+
+typedef struct
+{
+    const char *name;
+    void (*isr)(void);
+    int (*pending)(void);
+    int ccr0_reg;  // Vetor de fonte única: CCIFG limpo na entrada (-1 se não)
+} sim_vector_t;
+
+// Ordem de prioridade do MSP430F5529 (maior primeiro)
+static sim_vector_t vectors[] = {
+    { "COMP_B",    COMP_B_ISR,    pend_comp_b, -1 },
+    { "TIMER0_B0", TIMER0_B0_ISR, pend_tb0_0, SIM_TB0CCTL0 },
+    { "TIMER0_B1", TIMER0_B1_ISR, pend_tb0_1, -1 },
+    { "USCI_B0",   USCI_B0_ISR,   pend_ucb0,  -1 },
+    { "ADC12",     ADC12_ISR,     pend_adc12, -1 },
+    { "TIMER0_A0", TIMER0_A0_ISR, pend_ta0_0, SIM_TA0CCTL0 },
+    { "TIMER0_A1", TIMER0_A1_ISR, pend_ta0_1, -1 },
+    { "DMA",       DMA_ISR,       pend_dma,   -1 },
+    { "TIMER1_A0", TIMER1_A0_ISR, pend_ta1_0, SIM_TA1CCTL0 },
+    { "TIMER1_A1", TIMER1_A1_ISR, pend_ta1_1, -1 },
+    { "PORT1",     PORT1_ISR,     pend_port1, -1 },
+    { "USCI_A1",   USCI_A1_ISR,   pend_uca1,  -1 },
+    { "TIMER2_A0", TIMER2_A0_ISR, pend_ta2_0, SIM_TA2CCTL0 },
+    { "TIMER2_A1", TIMER2_A1_ISR, pend_ta2_1, -1 },
+    { "PORT2",     PORT2_ISR,     pend_port2, -1 },
+    { "RTC",       RTC_ISR,       rtc_pending, -1 },
+};
+#define NVECTORS (int)(sizeof(vectors) / sizeof(vectors[0]))
+
+/*
+ * NÚCLEO
+ */
+
+// Efeitos colaterais de leitura, aplicados antes de devolver o registrador
+static void sim_before_access(int id)
+{
+    int i;
+    switch (id)
+    {
+    case SIM_UCB0IV: i2c_iv(); break;
+    case SIM_UCA1IV: uart_iv(); break;
+    case SIM_ADC12IV: adc_iv(); break;
+    case SIM_FCTL3: flash_poll(); break;
+    case SIM_RTCIV: rtc_iv(); break;
+    case SIM_DMAIV: dma_iv(); break;
+    case SIM_UCSCTL7:
+    case SIM_SFRIFG1:
+        ucs_faults();
+        break;
+    case SIM_PMMIFG: pmm_flags(); break;
+    case SIM_P1IV: port_iv_read(0); break;
+    case SIM_P2IV: port_iv_read(1); break;
+    case SIM_CBIV: comp_iv(); break;
+    case SIM_RTCNT12:
+    case SIM_RTCNT34:
+        rtc_advance(sim_now);
+        break;
+    case SIM_UCB0TXBUF:
+    case SIM_UCA1TXBUF:
+        sim_regs[id] = 0xFFFF;  // Sentinela: qualquer escrita de byte é detectada
+        break;
+    default:
+        if (id >= SIM_ADC12MEM0 && id <= SIM_ADC12MEM15)
+            sim_regs[SIM_ADC12IFG] &= ~(1u << (id - SIM_ADC12MEM0));
+        for (i = 0; i < NTIMERS; i++)
+            if (id == timers[i].iv) timer_iv(&timers[i]);
+        break;
+    }
+}
+
+// Aplica a escrita feita pelo firmware no último registrador devolvido
+static void sim_commit(void)
+{
+    int id = sim_pending;
+    if (id < 0) return;
+    sim_pending = -1;
+
+    uint16_t old = sim_pending_old, val = sim_regs[id];
+    if (mpy_write(id)) return;
+    if (val == old) return;
+    sim_write_effects(id, old, val);
+    dma_service();
+}
+
+static void sim_write_effects(int id, uint16_t old, uint16_t val)
+{
+    int i;
+    for (i = 0; i < NTIMERS; i++)
+        if (id == timers[i].ctl) timer_write(&timers[i], id, old, val);
+    i2c_write(id, old, val);
+    uart_write(id, old, val);
+    adc_write(id, old, val);
+    flash_write(id, old, val);
+    rtc_write(id, old, val);
+    dma_write(id, old, val);
+    clock_write(id, old, val);
+    comp_write(id, old, val);
+}
+
+static uint64_t sim_next_event(void)
+{
+    uint64_t next = SIM_NEVER;
+    int i;
+    for (i = 0; i < NTIMERS; i++)
+    {
+        uint64_t t = timer_next(&timers[i]);
+        if (t < next) next = t;
+    }
+    if (i2c_phase != I2C_IDLE && i2c_phase != I2C_HOLD && i2c_t_end < next) next = i2c_t_end;
+    if (uart_busy && uart_t_end < next) next = uart_t_end;
+    if (adc_busy && adc_t_end < next) next = adc_t_end;
+    uint64_t t = rtc_next();
+    if (t < next) next = t;
+    t = bench_input_next();
+    if (t < next) next = t;
+    return next;
+}
+
+// Contabiliza um intervalo de estado constante
+static void sim_account(uint64_t dt)
+{
+    int level = vcore_level();
+    uint32_t f_sys = 0;
+
+    if (!(sim_sr & CPUOFF))
+    {
+        sim_stats.active_ps += dt;
+        f_sys = sim_clock_hz(SIM_MCLK);
+        sim_stats.mclk_cycles[level] += (double)dt * f_sys / SIM_PS_PER_S;
+        if (sim_ram) sim_stats.ram_cycles[level] += (double)dt * f_sys / SIM_PS_PER_S;
+    }
+    else if (sim_sr & SCG1) sim_stats.lpm3_ps += dt;
+    else
+    {
+        sim_stats.lpm0_ps += dt;
+        sim_stats.lpm0_dco_cycles += (double)dt * dco_hz(1) / SIM_PS_PER_S;
+    }
+    if (sim_clock_on(SIM_SMCLK) && sim_clock_hz(SIM_SMCLK) > f_sys) f_sys = sim_clock_hz(SIM_SMCLK);
+    if (f_sys > vcore_max_hz[level]) sim_stats.vcore_violation_ps += dt;
+    if (refo_on()) sim_stats.refo_ps += dt;
+
+    if (i2c_phase != I2C_IDLE) sim_stats.i2c_busy_ps += dt;
+    if (uart_busy) sim_stats.uart_busy_ps += dt;
+    if (sim_regs[SIM_ADC12CTL0] & ADC12ON) sim_stats.adc_on_ps += dt;
+    if (ref_on()) sim_stats.ref_on_ps += dt;
+    if (sim_regs[SIM_CBCTL1] & CBON) sim_stats.comp_on_ps += dt;
+    if (sim_now < flash_busy_until) sim_stats.flash_busy_ps += dt;
+
+    // Periféricos alimentados pelo SMCLK congelam quando ele para. Os pedidos
+    // condicionais de clock (UCSCTL8) não são modelados: o firmware os desliga.
+    if (!sim_clock_on(SIM_SMCLK))
+    {
+        if (i2c_phase != I2C_IDLE && i2c_phase != I2C_HOLD) i2c_t_end += dt;
+        if (adc_busy && adc_clk == SIM_SMCLK) adc_t_end += dt;
+    }
+    if (uart_busy && !sim_clock_on(uart_clock())) uart_t_end += dt;
+
+    bench_segment(dt);
+}
+
+static void sim_advance_to(uint64_t t)
+{
+    int i;
+    for (;;)
+    {
+        i2c_process();
+        uart_process();
+        dma_service();
+        adc_process();
+        if (sim_now >= t) break;
+
+        uint64_t next = sim_next_event();
+        if (next <= sim_now) next = sim_now + 1;
+        if (next > t) next = t;
+
+        sim_account(next - sim_now);
+        sim_now = next;
+        for (i = 0; i < NTIMERS; i++) timer_advance(&timers[i], sim_now);
+        rtc_advance(sim_now);
+        while (bench_input_next() <= sim_now) bench_input();
+        comp_update();
+    }
+}
+
+static void sim_check_end(void)
+{
+    if (sim_now >= sim_end && !sim_finishing)
+    {
+        sim_finishing = 1;
+        bench_finish();
+        exit(0);
+    }
+}
+
+// Executa a ISR de maior prioridade pendente, se GIE permitir
+static int sim_dispatch(void)
+{
+    int i;
+    if (!(sim_sr & GIE)) return 0;
+
+    for (i = 0; i < NVECTORS; i++)
+        if (vectors[i].pending()) break;
+    if (i == NVECTORS) return 0;
+
+    sim_vector_t *v = &vectors[i];
+    if (!v->isr)
+    {
+        fprintf(stderr, "sim: interrupção %s sem ISR no firmware\n", v->name);
+        exit(2);
+    }
+
+    unsigned int saved_sr = sim_sr;
+    unsigned int saved_bic = sim_exit_bic, saved_bis = sim_exit_bis;
+    int saved_ram = sim_ram;
+    sim_exit_bic = 0;
+    sim_exit_bis = 0;
+    sim_sr = 0;  // CPU ligada, GIE desligado durante a ISR
+    sim_isr_depth++;
+    sim_stats.interrupts++;
+
+    if (v->ccr0_reg >= 0) sim_regs[v->ccr0_reg] &= ~CCIFG;
+    sim_ram = sim_in_ram((const void *)v->isr);
+    sim_cpu(SIM_ISR_ENTRY);
+    v->isr();
+    sim_commit();
+    sim_ram = sim_in_ram((const void *)v->isr);
+    sim_cpu(SIM_ISR_EXIT);
+    sim_ram = saved_ram;
+
+    sim_isr_depth--;
+    sim_sr = (saved_sr & ~sim_exit_bic) | sim_exit_bis;
+    sim_exit_bic = saved_bic;
+    sim_exit_bis = saved_bis;
+    return 1;
+}
+
+// CPU ligada executando 'cycles' ciclos de MCLK
+static void sim_cpu(uint32_t cycles)
+{
+    sim_stats.active_cycles += cycles;
+    sim_advance_to(sim_now + cycles_ps(cycles, sim_clock_hz(SIM_MCLK)));
+    while (sim_dispatch());
+    sim_check_end();
+}
+
+volatile uint16_t *sim_reg(int id)
+{
+    sim_commit();
+    SIM_CALLER();
+    sim_cpu(SIM_ACCESS_CYCLES);
+    sim_before_access(id);
+    sim_pending = id;
+    sim_pending_old = sim_regs[id];
+    return &sim_regs[id];
+}
+
+/*
+ * INTRÍNSECOS
+ */
+
+void __bis_SR_register(unsigned int bits)
+{
+    sim_commit();
+    sim_sr |= bits;
+    if (!(sim_sr & CPUOFF))
+    {
+        SIM_CALLER();
+        sim_cpu(1);
+        return;
+    }
+
+    // Dormindo: avança direto de evento em evento até uma ISR acordar a CPU
+    for (;;)
+    {
+        if (sim_dispatch())
+        {
+            if (!(sim_sr & CPUOFF)) break;
+            continue;
+        }
+        uint64_t next = sim_next_event();
+        if (next > sim_end) next = sim_end;
+        sim_advance_to(next);
+        sim_check_end();
+    }
+    sim_stats.wakeups++;
+}
+
+void __bic_SR_register(unsigned int bits)
+{
+    sim_commit();
+    sim_sr &= ~bits;
+}
+
+void __bic_SR_register_on_exit(unsigned int bits)
+{
+    sim_exit_bic |= bits;
+}
+
+void __bis_SR_register_on_exit(unsigned int bits)
+{
+    sim_exit_bis |= bits;
+}
+
+unsigned int __get_SR_register(void)
+{
+    return sim_sr;
+}
+
+void __enable_interrupt(void)
+{
+    sim_commit();
+    sim_sr |= GIE;
+    SIM_CALLER();
+    sim_cpu(1);
+}
+
+void __disable_interrupt(void)
+{
+    sim_commit();
+    sim_sr &= ~GIE;
+    SIM_CALLER();
+    sim_cpu(1);
+}
+
+void __delay_cycles(unsigned long cycles)
+{
+    sim_commit();
+    SIM_CALLER();
+    sim_cpu((uint32_t)cycles);
+}
+
+void __no_operation(void)
+{
+    sim_commit();
+    SIM_CALLER();
+    sim_cpu(1);
+}
+
+/*
+ * EXECUÇÃO
+ */
+
+// Valores de reset relevantes
+static void sim_reset(void)
+{
+    memset(sim_regs, 0, sizeof(uint16_t) * SIM_NREGS);
+    memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+    sim_regs[SIM_UCB0CTL1] = UCSWRST;
+    sim_regs[SIM_UCA1CTL1] = UCSWRST;
+    sim_regs[SIM_UCA1IFG] = UCTXIFG;
+    sim_regs[SIM_REFCTL0] = REFMSTR;
+    sim_regs[SIM_FCTL1] = FRKEY;
+    sim_regs[SIM_FCTL3] = FRKEY | LOCKA | WAIT | LOCK;
+    sim_regs[SIM_FCTL4] = FRKEY;
+    sim_regs[SIM_RTCCTL01] = RTCHOLD;
+    sim_regs[SIM_UCSCTL1] = DCORSEL_2;
+    sim_regs[SIM_UCSCTL2] = FLLD_1 | 31;  // DCOCLKDIV = 32 x REFO = 1048576 Hz
+    sim_regs[SIM_UCSCTL4] = SELS__DCOCLKDIV | SELM__DCOCLKDIV;  // ACLK = XT1
+    sim_regs[SIM_UCSCTL6] = 0xC000 | XT2OFF | XT1DRIVE_3 | XCAP_3 | XT1OFF;
+    sim_regs[SIM_UCSCTL7] = XT2OFFG | XT1LFOFFG | DCOFFG;
+    sim_regs[SIM_UCSCTL8] = 0x0707;
+    sim_regs[SIM_SFRIFG1] = OFIFG;
+    sim_regs[SIM_SVSMHCTL] = SVMHE | SVSHE;
+    sim_regs[SIM_SVSMLCTL] = SVMLE | SVSLE;
+    sim_regs[SIM_P1IN] = BIT1;  // Botões S1/S2 soltos (pull-up)
+    sim_regs[SIM_P2IN] = BIT1;
+}
+
+void sim_run(void (*entry)(void), uint64_t end_ps)
+{
+    sim_reset();
+    sim_end = end_ps;
+    entry();
+    fprintf(stderr, "sim: o firmware retornou do main\n");
+    bench_finish();
+    exit(0);
+}
@@ -0,0 +1,76 @@
+/*
+ * INTERFACE DO MODELO DE HOST
+ *
+ * sim.c modela em tempo virtual os periféricos do MSP430F5529 usados pelo
+ * ProjetoFinal.c. bench.c fornece o cenário (sinais analógicos, cargas
+ * externas) e gera o relatório.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_PS_PER_S  1000000000000ULL   // Tempo virtual em picossegundos
+#define SIM_NEVER     UINT64_MAX
+
+// Fontes de clock
+#define SIM_ACLK   0
+#define SIM_SMCLK  1
+#define SIM_MCLK   2
+
+// Contadores acumulados pelo modelo
+typedef struct
+{
+    uint64_t active_ps;        // CPU ligada (inclui ISRs)
+    uint64_t lpm0_ps;          // LPM0/LPM1
+    uint64_t lpm3_ps;          // LPM2..LPM4
+    uint64_t active_cycles;    // Ciclos de MCLK estimados com a CPU ligada
+    uint32_t wakeups;          // Saídas de LPM
+    uint32_t interrupts;       // ISRs executadas
+    uint32_t i2c_starts;       // START e START repetido
+    uint32_t i2c_bytes;        // Bytes no barramento (endereço + dados)
+    uint32_t i2c_nacks;
+    uint64_t i2c_busy_ps;
+    uint32_t uart_bytes;
+    uint64_t uart_busy_ps;
+    uint32_t adc_conversions;
+    uint64_t adc_on_ps;
+    uint64_t ref_on_ps;
+    uint32_t lcd_instructions; // Instruções/dados completos recebidos pelo LCD
+    uint32_t lcd_violations;   // Escritas com o LCD ocupado ou fora de tempo
+    uint32_t flash_erases;     // Segmentos apagados
+    uint32_t flash_words;      // Palavras gravadas
+    uint64_t flash_busy_ps;
+    uint32_t dma_transfers;
+    uint64_t comp_on_ps;       // Comparator_B ligado
+    double mclk_cycles[4];     // Ciclos de MCLK com a CPU ligada, por nível de PMMCOREV
+    double ram_cycles[4];      // Parte de mclk_cycles executando da RAM (RAMFUNC)
+    double lpm0_dco_cycles;    // Ciclos de DCOCLKDIV em LPM0 (o DCO segue ligado)
+    uint64_t refo_ps;          // REFO ligado (ACLK ou referência do FLL)
+    uint64_t vcore_violation_ps; // MCLK/SMCLK acima do máximo do Vcore atual
+} sim_stats_t;
+
+extern uint64_t sim_now;
+extern sim_stats_t sim_stats;
+extern uint16_t sim_regs[];
+extern FILE *sim_uart_log;      // Se não nulo, recebe os bytes da UART A1
+extern uint8_t sim_info_mem[512]; // Memória de informação (começa apagada)
+
+void sim_run(void (*entry)(void), uint64_t end_ps);
+uint32_t sim_clock_hz(int clk);
+int sim_cpu_on(void);
+uint8_t sim_pcf8574(void);      // Saídas atuais do expansor do LCD
+void sim_port_in(int port, uint8_t mask, int level); // Entrada de P1/P2 (borda -> PxIFG)
+double sim_timer_duty(int timer, int n); // TA0, TA1, TA2, TB0 = 0..3; saída n
+void sim_lcd_line(int row, char *out);  // 16 caracteres visíveis + '\0'
+
+// Ganchos implementados pelo cenário (bench.c)
+double bench_analog(int inch);  // Tensão no canal analógico, em volts
+double bench_avcc(void);
+void bench_segment(uint64_t dt); // Intervalo de duração dt com estado constante
+uint64_t bench_input_next(void); // Próxima mudança de entrada digital (SIM_NEVER se nenhuma)
+void bench_input(void);          // Aplica as mudanças de entrada que vencem em sim_now
+void bench_finish(void);         // Fim da simulação; não retorna
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * DECODIFICADOR DA TELEMETRIA BINÁRIA
+ *
+ * Lê o fluxo da UART de backchannel (arquivo ou stdin), acha os quadros da
+ * telemetria do ProjetoFinal.c (compilado com TELEMETRY_ENABLE) e imprime
+ * uma linha JSON por quadro. Bytes fora de quadros válidos (as linhas de
+ * texto dos despejos, quadros corrompidos) são ignorados; o total vai para
+ * stderr.
+ *
+ * Uso: ./telemetry [arquivo]
+ *      ./bench -s dry_spell -u uart.bin && ./telemetry uart.bin
+ *
+ * Formato (ver TELEMETRIA BINÁRIA no ProjetoFinal.c):
+ *   0xA5, tamanho, payload (little-endian), CRC-16-CCITT (tamanho + payload)
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TELEM_SYNC     0xA5
+#define TELEM_VERSION  1
+#define TELEM_PAYLOAD  22
+#define TELEM_FRAME    (TELEM_PAYLOAD + 4)
+
+#define TELEM_DRY      0x01
+#define TELEM_PUMPED   0x02
+#define TELEM_BOOT     0x04
+
+static uint16_t crc16_update(uint16_t crc, uint8_t byte)
+{
+    int i;
+    crc ^= (uint16_t)byte << 8;
+    for (i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    return crc;
+}
+
+static uint32_t get_le(const uint8_t *p, int bytes)
+{
+    uint32_t v = 0;
+    while (bytes--) v = (v << 8) | p[bytes];
+    return v;
+}
+
+// Quadro completo em f[0..TELEM_FRAME-1]; devolve 0 se não for válido
+static int decode(const uint8_t *f)
+{
+    uint16_t crc = 0xFFFF;
+    int i;
+
+    if (f[0] != TELEM_SYNC || f[1] != TELEM_PAYLOAD || f[2] != TELEM_VERSION) return 0;
+    for (i = 1; i < TELEM_PAYLOAD + 2; i++) crc = crc16_update(crc, f[i]);
+    if (crc != get_le(f + TELEM_PAYLOAD + 2, 2)) return 0;
+
+    const uint8_t *p = f + 2;
+    uint8_t flags = p[17];
+    printf("{\"seq\":%u,\"minute\":%u,\"moisture\":%u,\"min\":%u,\"max\":%u,\"mean\":%u,",
+           get_le(p + 1, 2), get_le(p + 3, 4), p[7], p[8], p[9], p[10]);
+    printf("\"trend_pct_h\":%.1f,\"dry_min\":%u,\"interval_s\":%u,",
+           (int16_t)get_le(p + 11, 2) / 10.0, get_le(p + 13, 2), get_le(p + 15, 2));
+    printf("\"dry\":%s,\"pumped\":%s,\"boot\":%s,\"pump_s\":%u}\n",
+           flags & TELEM_DRY ? "true" : "false", flags & TELEM_PUMPED ? "true" : "false",
+           flags & TELEM_BOOT ? "true" : "false", get_le(p + 18, 4));
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    uint8_t win[TELEM_FRAME];
+    int len = 0, c;
+    unsigned long frames = 0, skipped = 0;
+
+    if (argc > 1 && !(in = fopen(argv[1], "rb")))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // Janela deslizante: com um quadro válido consome tudo, senão um byte
+    while ((c = fgetc(in)) != EOF)
+    {
+        win[len++] = (uint8_t)c;
+        if (win[0] != TELEM_SYNC)
+        {
+            len = 0;
+            skipped++;
+            continue;
+        }
+        if (len < TELEM_FRAME) continue;
+        if (decode(win))
+        {
+            frames++;
+            len = 0;
+            continue;
+        }
+
+        // Sincronismo falso: procura o próximo 0xA5 dentro da janela
+        int i = 1;
+        while (i < len && win[i] != TELEM_SYNC) i++;
+        skipped += i;
+        for (c = i; c < len; c++) win[c - i] = win[c];
+        len -= i;
+    }
+
+    fprintf(stderr, "telemetry: %lu quadros, %lu bytes ignorados\n", frames, skipped);
+    return 0;
+}
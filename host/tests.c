@@ -0,0 +1,1052 @@
+/*
+ * TESTES DO FIRMWARE NO MODELO DE HOST
+ *
+ * Chama rotinas do ProjetoFinal.c diretamente sobre o modelo de
+ * registradores (sim.c), cada teste num processo novo (o firmware começa
+ * do reset). Imprime uma linha por verificação que falhar e as medidas de
+ * cada teste; sai com 1 se algo falhou.
+ *
+ * Uso: ./tests [nome]     (make test roda todos)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "msp430.h"
+#include "sim.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                                   \
+    do                                                                     \
+    {                                                                      \
+        if (!(cond))                                                       \
+        {                                                                  \
+            printf("  FALHA %s:%d: ", __FILE__, __LINE__);                 \
+            printf(__VA_ARGS__);                                           \
+            putchar('\n');                                                 \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+/* * CONFIGURAÇÃO DO ADC (mesmos -D e padrões do ProjetoFinal.c) * */
+#ifndef ZONES
+#define ZONES 1
+#endif
+#ifndef ADC_SAMPLES
+#if ZONES > 2
+#define ADC_SAMPLES         (16 / ZONES)
+#else
+#define ADC_SAMPLES         8
+#endif
+#endif
+#define ADC_FILTER_MEDIAN   0
+#define ADC_FILTER_TRIMMED  1
+#ifndef ADC_FILTER
+#define ADC_FILTER          ADC_FILTER_MEDIAN
+#endif
+#ifndef ADC_TRIM
+#define ADC_TRIM            2
+#endif
+
+/* * CALIBRAÇÃO (o mesmo layout do cal_t do ProjetoFinal.c) * */
+#define CAL_POINTS 5
+#define CAL_SLOTS  4
+
+typedef struct
+{
+    uint16_t code;
+    uint16_t pct;
+} cal_point_t;
+
+typedef struct
+{
+    uint16_t magic;
+    cal_point_t point[CAL_SLOTS][CAL_POINTS];
+    uint16_t checksum;
+} cal_t;
+
+/* * ARQUIVO (o mesmo layout do arch_ring_t do ProjetoFinal.c) * */
+#define ARCH_TIERS  3
+#define ARCH_HOURS  48
+#define ARCH_DAYS   60
+#define ARCH_WEEKS  26
+
+typedef struct
+{
+    uint8_t *nib;
+    uint16_t size;
+    uint16_t tail;
+    uint16_t used;
+    uint8_t count;
+    uint8_t limit;
+    uint8_t fields;
+    uint8_t first;
+    uint8_t last;
+} arch_ring_t;
+
+/* * ROTINAS DO FIRMWARE * */
+void Init_Peripherals(void);
+void Clock_Init(void);
+void LCD_Init(void);
+void LCD_Update(char *str);
+void I2C_Send(uint8_t addr, uint8_t data);
+void I2C_Wait_Idle(void);
+void History_Insert(uint8_t value, uint16_t dt_s);
+uint8_t Stats_Min(void);
+uint8_t Stats_Max(void);
+uint8_t Stats_Mean(void);
+int16_t Stats_Trend(void);
+uint16_t ADC_Reduce(uint16_t *samples);
+void ADC_Power_On(void);
+void ADC_Power_Off(void);
+void convert(uint16_t *results);
+void Cal_Two_Point(uint8_t z, uint16_t wet, uint16_t dry);
+void Cal_Prepare(void);
+uint8_t Cal_Percent(uint8_t z, uint16_t code);
+uint16_t Cal_Code(uint8_t z, uint8_t pct);
+extern cal_t cal;
+void Archive_Insert(uint8_t value);
+void Arch_Push(arch_ring_t *r, uint8_t mean, uint8_t min, uint8_t max);
+void Arch_Decode(const arch_ring_t *r, uint16_t *pos, uint8_t i,
+                 uint8_t *mean, uint8_t *min, uint8_t *max);
+extern arch_ring_t arch[ARCH_TIERS];
+void Log_Recover(void);
+void Log_Append(uint8_t value);
+extern uint8_t log_flash[];
+extern uint16_t log_seq;
+extern uint32_t history_clock_s;
+extern uint8_t history_count;
+
+/* * GANCHOS DO CENÁRIO (fixo: sonda a meio caminho, alimentação estável) * */
+static double analog_noise_v = 0.0;  // Desvio do ruído branco na sonda
+
+static double normal(void)
+{
+    double u = drand48(), v = drand48();
+    return sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * M_PI * v);
+}
+
+double bench_analog(int inch) { return 1.65 + analog_noise_v * normal(); }
+double bench_avcc(void) { return 3.3; }
+void bench_segment(uint64_t dt) {}
+uint64_t bench_input_next(void) { return SIM_NEVER; }
+void bench_input(void) {}
+
+void bench_finish(void)
+{
+    fflush(stdout);
+    exit(failures ? 1 : 0);
+}
+
+// Boot do main() até o LCD pronto, no perfil de clock padrão (1 MHz)
+static void boot(void)
+{
+    WDTCTL = WDTPW | WDTHOLD;
+    Init_Peripherals();
+    __enable_interrupt();
+    Clock_Init();
+    LCD_Init();
+}
+
+static void expect_lcd(const char *row0, const char *row1)
+{
+    char line[17];
+    sim_lcd_line(0, line);
+    CHECK(!strcmp(line, row0), "linha 1 \"%s\", esperado \"%s\"", line, row0);
+    sim_lcd_line(1, line);
+    CHECK(!strcmp(line, row1), "linha 2 \"%s\", esperado \"%s\"", line, row1);
+}
+
+/*
+ * LCD_UPDATE: SONDAGEM CONTRA FILA
+ */
+
+#define LCD_ADDR 0x27
+#define RS_BIT   BIT0
+#define RW_BIT   BIT1
+#define EN_BIT   BIT2
+#define BL_BIT   BIT3
+
+// Caminho original (commit base): cada byte é uma transação I2C esperada
+// em laço, e os atrasos são contados no TA0 com a CPU ligada
+static void polled_send(uint8_t addr, uint8_t data)
+{
+    UCB0I2CSA = addr;
+    while (UCB0STAT & UCBBUSY);
+    UCB0CTL1 |= UCTXSTT | UCTR;
+    while ((UCB0IFG & UCTXIFG) == 0);
+    UCB0TXBUF = data;
+    while (UCB0CTL1 & UCTXSTT);
+    if (UCB0IFG & UCNACKIFG)
+    {
+        UCB0CTL1 |= UCTXSTP;
+        UCB0IFG &= ~UCNACKIFG;
+    }
+    else UCB0CTL1 |= UCTXSTP;
+    while (UCB0CTL1 & UCTXSTP);
+}
+
+static void polled_delay_us(unsigned int time_us)
+{
+    TA0CCR0 = time_us;
+    TA0CTL = TASSEL__SMCLK | ID__1 | MC_1 | TACLR;
+    while ((TA0CTL & TAIFG) == 0);
+    TA0CTL = MC_0 | TACLR;
+}
+
+// send: polled_send (original) ou I2C_Send (fila do user-001, um quadro por
+// byte). A fila dispensa os atrasos por nibble: cada transação já dura
+// mais que o pulso de EN e a instrução.
+static void nibble(void (*send)(uint8_t, uint8_t), uint8_t n, uint8_t isChar)
+{
+    uint8_t v = (n & 0xF0) | BL_BIT | (isChar ? RS_BIT : 0);
+    send(LCD_ADDR, v);
+    send(LCD_ADDR, v | EN_BIT);
+    if (send == polled_send) polled_delay_us(10);
+    send(LCD_ADDR, v);
+    if (send == polled_send) polled_delay_us(50);
+}
+
+static void byte_out(void (*send)(uint8_t, uint8_t), uint8_t b, uint8_t isChar)
+{
+    nibble(send, b, isChar);
+    nibble(send, b << 4, isChar);
+}
+
+// LCD_Update do commit base: limpa a tela e reescreve tudo
+static void full_update(void (*send)(uint8_t, uint8_t), const char *str)
+{
+    byte_out(send, 0x01, 0);  // CMD_CLEAR_DISPLAY
+    if (send != polled_send) I2C_Wait_Idle();
+    polled_delay_us(2000);
+    for (; *str; str++)
+    {
+        if (*str == '\n') byte_out(send, 0xC0, 0);  // CMD_SECOND_LINE
+        else byte_out(send, *str, 1);
+    }
+    if (send != polled_send) I2C_Wait_Idle();
+}
+
+static void shadow_update(void (*send)(uint8_t, uint8_t), const char *str)
+{
+    char buf[40];
+    strcpy(buf, str);
+    LCD_Update(buf);
+    I2C_Wait_Idle();
+}
+
+// Ciclos de CPU ligada (main + ISRs) de uma atualização até o barramento
+// parar; o tempo em LPM0 esperando a fila não conta
+static uint64_t measure(void (*update)(void (*)(uint8_t, uint8_t), const char *),
+                        void (*send)(uint8_t, uint8_t), const char *str)
+{
+    uint64_t c0 = sim_stats.active_cycles;
+    update(send, str);
+    return sim_stats.active_cycles - c0;
+}
+
+#define SCREEN_A "      Solo Umido\n   27% - 27-32  "
+#define SCREEN_B "      Solo Umido\n   26% - 26-32  "
+
+static void test_lcd_update(void)
+{
+    static const struct
+    {
+        const char *name;
+        void (*update)(void (*)(uint8_t, uint8_t), const char *);
+        void (*send)(uint8_t, uint8_t);
+    } paths[] = {
+        { "sondagem (base)", full_update, polled_send },
+        { "fila, 1 byte/quadro (user-001)", full_update, I2C_Send },
+        { "rajada + espelho (atual)", shadow_update, 0 },
+    };
+    int i;
+
+    boot();
+    for (i = 0; i < 3; i++)
+    {
+        uint32_t violations = sim_stats.lcd_violations;
+
+        // Tela inteira a partir da limpa, depois a troca de uma leitura. O
+        // espelho só é usado pelo último caminho e começa limpo (LCD_Init).
+        full_update(polled_send, "");
+        uint32_t starts = sim_stats.i2c_starts;
+        uint64_t full = measure(paths[i].update, paths[i].send, SCREEN_A);
+        starts = sim_stats.i2c_starts - starts;
+        expect_lcd("      Solo Umido", "   27% - 27-32  ");
+        uint64_t step = measure(paths[i].update, paths[i].send, SCREEN_B);
+        expect_lcd("      Solo Umido", "   26% - 26-32  ");
+
+        printf("  %-32s tela inteira %7llu ciclos em %3u transações, "
+               "troca de leitura %7llu ciclos\n", paths[i].name, (unsigned long long)full,
+               starts, (unsigned long long)step);
+        CHECK(sim_stats.lcd_violations == violations, "%u escritas fora de tempo no LCD",
+              sim_stats.lcd_violations - violations);
+    }
+
+    // A rajada leva a tela inteira, nas duas linhas, numa transação só
+    char full[] = "0123456789ABCDEF\nfedcba9876543210";
+    uint32_t starts = sim_stats.i2c_starts;
+    LCD_Update(full);
+    I2C_Wait_Idle();
+    expect_lcd("0123456789ABCDEF", "fedcba9876543210");
+    CHECK(sim_stats.i2c_starts - starts == 1, "tela inteira em %u transações",
+          sim_stats.i2c_starts - starts);
+}
+
+/*
+ * ESTATÍSTICAS DA JANELA CONTRA FORÇA BRUTA
+ */
+
+#define HISTORY_SIZE  24
+#define STATS_TICK_S  600
+
+static uint32_t rng = 12345;
+
+static uint32_t rand_u32(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+// Janela refeita do zero a cada leitura: mínimo, máximo, média arredondada
+// e a reta de mínimos quadrados com x em ticks de STATS_TICK_S, em 0,1 %/h
+static void check_window(const uint8_t *v, const uint32_t *tick, int n, int at)
+{
+    uint8_t min = 255, max = 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    unsigned sum = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        double x = -(double)(tick[n - 1] - tick[i]);
+        if (v[i] < min) min = v[i];
+        if (v[i] > max) max = v[i];
+        sum += v[i];
+        sx += x;
+        sy += v[i];
+        sxx += x * x;
+        sxy += x * v[i];
+    }
+
+    double den = n * sxx - sx * sx, trend = 0;
+    if (n >= 2 && den > 0) trend = (n * sxy - sx * sy) * 60.0 / den;
+    if (trend > 30000) trend = 30000;
+    if (trend < -30000) trend = -30000;
+
+    CHECK(Stats_Min() == min, "leitura %d: mínimo %u, esperado %u", at, Stats_Min(), min);
+    CHECK(Stats_Max() == max, "leitura %d: máximo %u, esperado %u", at, Stats_Max(), max);
+    CHECK(Stats_Mean() == (sum + n / 2) / n, "leitura %d: média %u, esperado %u", at,
+          Stats_Mean(), (sum + n / 2) / n);
+    CHECK(fabs(Stats_Trend() - trend) <= 1.0, "leitura %d: tendência %d, esperado %.2f", at,
+          Stats_Trend(), trend);
+}
+
+static void test_stats(void)
+{
+    // Intervalos do firmware (SAMPLE_MIN_S a SAMPLE_MAX_S x 4 na economia de
+    // bateria), leituras antecipadas pelo comparador fora do passo de 10 min
+    // e o teto de 16 bits do Log_Recover
+    static const uint16_t dts[] = { 600, 600, 1800, 3600, 14400, 57600, 65535, 37, 1234 };
+    uint8_t v[HISTORY_SIZE];
+    uint32_t tick[HISTORY_SIZE], clock_s = 0;
+    int n = 0, i, k, worst = 0;
+
+    for (i = 0; i < 20000; i++)
+    {
+        int phase = (i / 1000) % 4;
+        uint16_t dt = i == 0 ? 0 : dts[rand_u32() % (sizeof(dts) / sizeof(dts[0]))];
+        uint8_t value;
+
+        if (phase == 1) dt = 65535;                          // Janela mais longa
+        if (phase == 2) value = (i & 1) ? 100 : 0;           // Maior variância
+        else if (phase == 3) value = (uint8_t)(i % 101);     // Rampas
+        else value = rand_u32() % 101;
+
+        History_Insert(value, dt);
+        clock_s += dt;
+
+        if (n == HISTORY_SIZE)
+        {
+            for (k = 1; k < n; k++)
+            {
+                v[k - 1] = v[k];
+                tick[k - 1] = tick[k];
+            }
+            n--;
+        }
+        v[n] = value;
+        tick[n] = clock_s / STATS_TICK_S;
+        n++;
+
+        int before = failures;
+        check_window(v, tick, n, i);
+        if (failures > before && ++worst >= 10) return;  // Não inunda a saída
+    }
+    printf("  %d leituras conferidas\n", i);
+}
+
+/*
+ * ADC_REDUCE: MEDIANA OU MÉDIA APARADA DA RAJADA
+ */
+
+static int cmp_u16(const void *a, const void *b)
+{
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+// O filtro configurado, direto da definição: ordena e tira a mediana ou a
+// média (arredondada) sem as ADC_TRIM de cada ponta
+static uint16_t reduce_ref(const uint16_t *in)
+{
+    uint16_t v[ADC_SAMPLES];
+    memcpy(v, in, sizeof(v));
+    qsort(v, ADC_SAMPLES, sizeof(v[0]), cmp_u16);
+#if ADC_FILTER == ADC_FILTER_MEDIAN
+    if (ADC_SAMPLES % 2) return v[ADC_SAMPLES / 2];
+    return (uint16_t)((v[ADC_SAMPLES / 2 - 1] + v[ADC_SAMPLES / 2] + 1) / 2);
+#else
+    uint32_t sum = 0;
+    int i, n = ADC_SAMPLES - 2 * ADC_TRIM;
+    for (i = ADC_TRIM; i < ADC_SAMPLES - ADC_TRIM; i++) sum += v[i];
+    return (uint16_t)((sum + n / 2) / n);
+#endif
+}
+
+static void check_burst(const char *name, const uint16_t *in)
+{
+    uint16_t v[ADC_SAMPLES];
+    uint16_t want = reduce_ref(in), got;
+    memcpy(v, in, sizeof(v));
+    got = ADC_Reduce(v);
+    CHECK(got == want, "%s: %u, esperado %u", name, got, want);
+}
+
+static double variance(const double *x, int n)
+{
+    double m = 0, s = 0;
+    int i;
+    for (i = 0; i < n; i++) m += x[i];
+    m /= n;
+    for (i = 0; i < n; i++) s += (x[i] - m) * (x[i] - m);
+    return s / (n - 1);
+}
+
+#define ADC_BURSTS 2000
+
+static void test_adc_reduce(void)
+{
+    // Quantas amostras descartadas em cada ponta o filtro aguenta
+#if ADC_FILTER == ADC_FILTER_MEDIAN
+    const int reject = (ADC_SAMPLES - 1) / 2;
+    const double estimate = 2.0 * ADC_SAMPLES / M_PI;  // Mediana: var = π σ² / 2N
+#else
+    const int reject = ADC_TRIM;
+    const double estimate = ADC_SAMPLES - 2 * ADC_TRIM;  // Média das que sobram
+#endif
+    static double raw[ADC_BURSTS * ADC_SAMPLES], out[ADC_BURSTS];
+    uint16_t v[ADC_SAMPLES], res[ZONES];
+    int i, k;
+
+    printf("  %d amostras, %s", ADC_SAMPLES, ADC_FILTER == ADC_FILTER_MEDIAN ? "mediana" : "média");
+    if (ADC_FILTER != ADC_FILTER_MEDIAN) printf(" sem %d em cada ponta", ADC_TRIM);
+    putchar('\n');
+
+    // Rajadas conhecidas
+    for (i = 0; i < ADC_SAMPLES; i++) v[i] = 2048;
+    check_burst("iguais", v);
+    CHECK(ADC_Reduce(v) == 2048, "iguais: o filtro mudou o valor");
+
+    for (i = 0; i < ADC_SAMPLES; i++) v[i] = (uint16_t)(ADC_SAMPLES - i) * 3;
+    check_burst("decrescente", v);
+    for (i = 0; i < ADC_SAMPLES; i++) v[i] = (uint16_t)(4095 - i);
+    check_burst("perto do topo", v);
+    for (i = 0; i < ADC_SAMPLES; i++) v[i] = (uint16_t)(i & 1);
+    check_burst("0 e 1 alternados", v);  // Arredondamento da média de pares
+
+    // Extremos nas duas pontas: até 'reject' de cada lado não mexem no valor
+    for (k = 1; k <= reject; k++)
+    {
+        for (i = 0; i < ADC_SAMPLES; i++) v[i] = (uint16_t)(1000 + (i * 5) % 7);
+        for (i = 0; i < k; i++)
+        {
+            v[(i * 3) % ADC_SAMPLES] = 4095;
+            v[(i * 3 + 1) % ADC_SAMPLES] = 0;
+        }
+        check_burst("extremos", v);
+        uint16_t got = ADC_Reduce(v);
+        CHECK(got >= 1000 && got <= 1006, "%d extremos em cada ponta: %u fora das amostras boas", k,
+              got);
+    }
+
+    srand48(5);
+    for (k = 0; k < 20000; k++)
+    {
+        uint16_t m = (uint16_t)(drand48() * 4096);
+        for (i = 0; i < ADC_SAMPLES; i++) v[i] = k % 3 ? (uint16_t)(drand48() * 4096) : m;
+        if (k % 5 == 0) v[k % ADC_SAMPLES] = k & 1 ? 4095 : 0;
+        int before = failures;
+        check_burst("aleatória", v);
+        if (failures > before) break;
+    }
+
+    // Variância medida: rajadas do ADC do modelo com ruído branco na sonda
+    boot();
+    analog_noise_v = 0.02;  // ~25 LSB
+    for (k = 0; k < ADC_BURSTS; k++)
+    {
+        ADC_Power_On();
+        convert(res);
+        ADC_Power_Off();
+        for (i = 0; i < ADC_SAMPLES; i++) raw[k * ADC_SAMPLES + i] = (&ADC12MEM0)[i];
+        out[k] = res[0];
+    }
+    analog_noise_v = 0.0;
+
+    double single = variance(raw, ADC_BURSTS * ADC_SAMPLES), filtered = variance(out, ADC_BURSTS);
+    printf("  variância (LSB²): amostra %.1f, filtrada %.1f: %.2fx menor (estimativa %.2fx)\n",
+           single, filtered, single / filtered, estimate);
+    CHECK(single / filtered > 0.8 * estimate, "redução de %.2fx, estimativa %.2fx",
+          single / filtered, estimate);
+}
+
+/*
+ * CAL_PERCENT E CAL_CODE: CURVA LINEAR POR PARTES NO MPY32
+ */
+
+// A curva em double: ponta mais próxima fora dela, o trecho que contém o
+// código e a inclinação limitada como em Cal_Prepare (int16 em Q16). Em
+// *err fica quanto a inclinação truncada do firmware pode se afastar
+// disso: menos de 1/65536 por código desde o início do trecho.
+static double cal_ref(const cal_point_t *pt, int code, double *err)
+{
+    int s = 0;
+
+    if (code < pt[0].code) code = pt[0].code;
+    if (code > pt[CAL_POINTS - 1].code) code = pt[CAL_POINTS - 1].code;
+    while (s < CAL_POINTS - 2 && code >= pt[s + 1].code) s++;
+
+    double slope = ((double)pt[s + 1].pct - pt[s].pct) / (pt[s + 1].code - pt[s].code);
+    if (slope > 32767.0 / 65536) slope = 32767.0 / 65536;
+    if (slope < -32768.0 / 65536) slope = -32768.0 / 65536;
+    *err = (code - pt[s].code) / 65536.0 + 1e-9;
+    return pt[s].pct + slope * (code - pt[s].code);
+}
+
+static int cal_round(double x)
+{
+    int r = (int)floor(x + 0.5);
+    return r < 0 ? 0 : r > 100 ? 100 : r;
+}
+
+// Confere os 4096 códigos contra a referência e, se a curva for monotônica
+// e sem inclinação limitada, que Cal_Code(Cal_Percent(x)) cerca x
+static void check_curve(const char *name, const cal_point_t *curve, int invertible)
+{
+    int code, bad = 0, unbracketed = 0;
+    double worst = 0;
+
+    memcpy(cal.point[0], curve, sizeof(cal.point[0]));
+    Cal_Prepare();
+    for (code = 0; code < 4096; code++)
+    {
+        double err, x = cal_ref(curve, code, &err);
+        int got = Cal_Percent(0, (uint16_t)code);
+        int lo = cal_round(x - err), hi = cal_round(x + err);
+
+        if (got < lo || got > hi)
+        {
+            if (!bad++)
+                CHECK(0, "%s: código %d dá %d %%, curva %.4f %%", name, code, got, x);
+        }
+        if (fabs(got - x) > worst && x >= 0 && x <= 100) worst = fabs(got - x);
+
+        if (invertible)
+        {
+            // Fora da curva o código vale o da ponta
+            int in = code < curve[0].code ? curve[0].code
+                     : code > curve[CAL_POINTS - 1].code ? curve[CAL_POINTS - 1].code : code;
+            int below = got > 0 ? got - 1 : 0, above = got < 100 ? got + 1 : 100;
+            int a = Cal_Code(0, (uint8_t)below), b = Cal_Code(0, (uint8_t)above);
+            if (a > b)
+            {
+                int t = a;
+                a = b;
+                b = t;
+            }
+            if ((in < a || in > b) && !unbracketed++)
+                CHECK(0, "%s: código %d (%d %%) fora de Cal_Code %d..%d", name, code, got, a, b);
+            int back = Cal_Percent(0, Cal_Code(0, (uint8_t)got));
+            if (abs(back - got) > 1 && !unbracketed++)
+                CHECK(0, "%s: Cal_Code(%d) volta como %d %%", name, got, back);
+        }
+    }
+    CHECK(bad == 0, "%s: %d códigos fora da curva", name, bad);
+    CHECK(unbracketed == 0, "%s: %d códigos sem inverso em Cal_Code", name, unbracketed);
+    printf("  %s: 4096 códigos, erro máximo %.3f ponto%s\n", name, worst,
+           invertible ? ", Cal_Code conferido" : "");
+}
+
+static void test_cal(void)
+{
+    static const cal_point_t falling[CAL_POINTS] = {
+        { 300, 100 }, { 900, 80 }, { 1500, 45 }, { 2600, 12 }, { 3900, 0 } };
+    static const cal_point_t rising[CAL_POINTS] = {
+        { 200, 0 }, { 700, 3 }, { 1200, 30 }, { 3000, 90 }, { 3800, 100 } };
+    static const cal_point_t flat[CAL_POINTS] = {
+        { 200, 0 }, { 700, 0 }, { 1200, 30 }, { 3000, 30 }, { 3800, 100 } };
+    // 1 ponto por código: a inclinação passa do int16 nos dois sentidos
+    static const cal_point_t steep[CAL_POINTS] = {
+        { 1000, 100 }, { 1100, 0 }, { 1200, 0 }, { 1300, 0 }, { 1400, 100 } };
+
+    Cal_Two_Point(0, 0, 4095);
+    check_curve("reta padrão (0 a 4095)", cal.point[0], 1);
+    Cal_Two_Point(0, 3500, 800);
+    check_curve("reta crescente", cal.point[0], 1);
+    check_curve("5 pontos decrescente", falling, 1);
+    check_curve("5 pontos crescente", rising, 1);
+    check_curve("trechos planos", flat, 0);
+    check_curve("inclinação limitada", steep, 0);
+
+    // Na inclinação limitada o firmware anda só 0,5 ponto por código:
+    // 50 códigos depois do início são 25 pontos, não 50
+    memcpy(cal.point[0], steep, sizeof(cal.point[0]));
+    Cal_Prepare();
+    CHECK(Cal_Percent(0, 1050) == 75 && Cal_Percent(0, 1350) == 25, "inclinação limitada: %u e %u",
+          Cal_Percent(0, 1050), Cal_Percent(0, 1350));
+}
+
+/*
+ * ARQUIVO: NIBBLES EM ZIG-ZAG E FECHAMENTO HORA -> DIA -> SEMANA
+ */
+
+typedef struct
+{
+    uint8_t mean, min, max;
+    int cost;  // Nibbles no anel
+} arch_rec_t;
+
+// Referência de um nível: todos os registros já acrescentados, os guardados
+// são os de first em diante
+typedef struct
+{
+    arch_rec_t rec[8192];
+    int n, first, used;
+    int squeezed;  // Descartados por falta de espaço antes do limite
+    uint8_t last;
+} arch_ref_t;
+
+static int nibbles(uint8_t v) { return v < 15 ? 1 : 3; }
+
+// O que Arch_Push faz, sem nibbles: delta da média em zig-zag (módulo 256,
+// como a média) e as distâncias ao mínimo e ao máximo
+static void ref_push(arch_ref_t *ref, const arch_ring_t *r, uint8_t mean, uint8_t min, uint8_t max)
+{
+    int8_t delta = ref->n > ref->first ? (int8_t)(uint8_t)(mean - ref->last) : 0;
+    uint8_t zz = (uint8_t)(delta >= 0 ? 2 * delta : -2 * delta - 1);
+    arch_rec_t *rec = &ref->rec[ref->n];
+    int cost = nibbles(zz) + (r->fields == 3 ? nibbles(mean - min) + nibbles(max - mean) : 0);
+
+    while (ref->n > ref->first &&
+           (ref->n - ref->first >= r->limit || r->size - ref->used < 3 * r->fields))
+    {
+        if (ref->n - ref->first < r->limit) ref->squeezed++;
+        ref->used -= ref->rec[ref->first++].cost;
+    }
+    rec->mean = mean;
+    rec->min = r->fields == 3 ? min : mean;
+    rec->max = r->fields == 3 ? max : mean;
+    rec->cost = cost;
+    ref->used += cost;
+    ref->last = mean;
+    ref->n++;
+}
+
+// Decodifica o nível inteiro a partir de tail e compara com a referência
+static int check_ring(const char *name, const arch_ring_t *r, const arch_ref_t *ref)
+{
+    uint8_t mean = 0, min, max, i;
+    uint16_t pos = r->tail;
+    int before = failures;
+
+    CHECK(r->count == ref->n - ref->first, "%s: %u registros, esperados %d", name, r->count,
+          ref->n - ref->first);
+    CHECK(r->used == ref->used, "%s: %u nibbles, esperados %d", name, r->used, ref->used);
+    for (i = 0; i < r->count && i < ref->n - ref->first; i++)
+    {
+        const arch_rec_t *e = &ref->rec[ref->first + i];
+        Arch_Decode(r, &pos, i, &mean, &min, &max);
+        if (mean != e->mean || min != e->min || max != e->max)
+        {
+            CHECK(0, "%s: registro %u é %u/%u/%u, esperado %u/%u/%u", name, i, mean, min, max,
+                  e->mean, e->min, e->max);
+            break;
+        }
+    }
+    return failures == before;
+}
+
+// Anel pequeno do próprio teste: escapes, zig-zag negativo, volta do anel
+// numa posição ímpar e descartes por falta de espaço
+static void arch_codec(const char *name, uint8_t fields, uint16_t size, uint8_t limit)
+{
+    static const uint8_t means[] = { 50, 50, 51, 49, 57, 43, 58, 42, 0, 255, 0, 128, 127,
+                                     7, 14, 100, 30, 30, 29, 37, 45, 38, 200, 1 };
+    static arch_ref_t ref;
+    uint8_t nib[64];
+    arch_ring_t r = { nib, size, 0, 0, 0, limit, fields, 0, 0 };
+    int i;
+
+    memset(&ref, 0, sizeof(ref));
+    srand48(9);
+    for (i = 0; i < 2000; i++)
+    {
+        uint8_t mean = i < (int)sizeof(means) ? means[i] : (uint8_t)(drand48() * 256);
+        uint8_t below = (uint8_t)(i % 3 ? drand48() * 20 : drand48() * (mean + 1));
+        uint8_t above = (uint8_t)(i % 4 ? drand48() * 20 : drand48() * (256 - mean));
+        if (below > mean) below = mean;
+        if (above > 255 - mean) above = 255 - mean;
+
+        ref_push(&ref, &r, mean, mean - below, mean + above);
+        Arch_Push(&r, mean, mean - below, mean + above);
+        char at[48];
+        snprintf(at, sizeof(at), "%s, push %d", name, i);
+        if (!check_ring(at, &r, &ref)) return;
+    }
+    printf("  %s: 2000 registros, %d descartados por espaço\n", name, ref.squeezed);
+}
+
+static void arch_ref_close(arch_ref_t *ref, const arch_ring_t *r, const uint32_t *acc, int n,
+                           uint8_t min, uint8_t max)
+{
+    ref_push(ref, r, (uint8_t)((acc[0] + n / 2) / n), min, max);
+}
+
+// Leituras com regas (quedas lentas e saltos de 50 pontos) e intervalos de
+// 10 min a 4 h, então há horas sem leitura; o arquivo tem de sair igual a
+// fechar hora, dia e semana à mão
+static void arch_rollup(void)
+{
+    static arch_ref_t hours, days, weeks;
+    static const uint8_t span[ARCH_TIERS] = { 0, 24, 7 };
+    arch_ref_t *ref[ARCH_TIERS] = { &hours, &days, &weeks };
+    uint32_t sum[ARCH_TIERS] = { 0 }, hour = 0;
+    uint8_t min[ARCH_TIERS] = { 0 }, max[ARCH_TIERS] = { 0 }, held = 0, value = 70;
+    int n[ARCH_TIERS] = { 0 }, t, readings = 0;
+    int started = 0;
+
+    srand48(3);
+    while (weeks.n < ARCH_WEEKS + 6)
+    {
+        uint32_t now = history_clock_s / 3600;
+        if (!started) hour = now;
+        started = 1;
+        while (hour != now)
+        {
+            if (!n[0])
+            {
+                sum[0] = held;
+                min[0] = max[0] = held;
+                n[0] = 1;
+            }
+            // Fecha a hora e, em cascata, o dia e a semana
+            for (t = 0; t < ARCH_TIERS; t++)
+            {
+                uint8_t mean = (uint8_t)((sum[t] + n[t] / 2) / n[t]);
+                arch_ref_close(ref[t], &arch[t], &sum[t], n[t], min[t], max[t]);
+                sum[t] = 0;
+                n[t] = 0;
+                if (t + 1 == ARCH_TIERS) break;
+                if (!n[t + 1] || min[t] < min[t + 1]) min[t + 1] = min[t];
+                if (!n[t + 1] || max[t] > max[t + 1]) max[t + 1] = max[t];
+                sum[t + 1] += mean;
+                if (++n[t + 1] < span[t + 1]) break;
+            }
+            hour++;
+        }
+        Archive_Insert(value);
+        if (!n[0] || value < min[0]) min[0] = value;
+        if (!n[0] || value > max[0]) max[0] = value;
+        sum[0] += value;
+        n[0]++;
+        held = value;
+        readings++;
+
+        value = value < 25 ? value + 50 : value - (uint8_t)(drand48() * 4);
+        history_clock_s += 600 + (uint32_t)(drand48() * drand48() * 13800);
+    }
+
+    check_ring("horas", &arch[0], &hours);
+    check_ring("dias", &arch[1], &days);
+    check_ring("semanas", &arch[2], &weeks);
+    printf("  %d leituras: %d horas, %d dias, %d semanas fechadas; guardados %u/%u/%u em "
+           "%u/%u/%u nibbles\n", readings, hours.n, days.n, weeks.n, arch[0].count, arch[1].count,
+           arch[2].count, arch[0].used, arch[1].used, arch[2].used);
+    CHECK(arch[0].count == ARCH_HOURS && arch[1].count == ARCH_DAYS && arch[2].count == ARCH_WEEKS,
+          "o arquivo não guarda a profundidade pedida");
+}
+
+static void test_archive(void)
+{
+    arch_codec("média, 25 nibbles", 1, 25, 200);
+    arch_codec("média/mín/máx, 41 nibbles", 3, 41, 200);
+    arch_codec("média/mín/máx, limite 6", 3, 127, 6);
+    arch_rollup();
+}
+
+/*
+ * LOG NA FLASH: GRAVAÇÃO INTERROMPIDA, RESETS E CUSTO DO BOOT
+ */
+
+#define LOG_BYTES        (32 * 512)   // LOG_SEGMENTS segmentos de 512 bytes
+#define LOG_PER_SEGMENT  64
+#define LOG_CAPACITY     (LOG_BYTES / 8)
+
+// Imagem da flash compartilhada entre os boots (cada um num processo)
+typedef struct
+{
+    uint8_t flash[LOG_BYTES];
+    uint16_t recovered;   // log_seq depois do Log_Recover
+    uint16_t next;        // log_seq no fim do boot
+    uint32_t clock_s;     // Relógio do histórico refeito pelo Log_Recover
+    uint8_t window;       // Leituras na janela refeita e a média delas
+    uint8_t mean;
+} log_image_t;
+
+static log_image_t *image;
+static int boot_appends;
+
+static void log_boot_entry(void)
+{
+    int i;
+    memcpy(log_flash, image->flash, LOG_BYTES);
+    Log_Recover();
+    image->clock_s = history_clock_s;
+    image->recovered = log_seq;
+    image->window = history_count;
+    image->mean = Stats_Mean();
+    for (i = 0; i < boot_appends; i++)
+    {
+        history_clock_s += 600;  // Uma leitura por SAMPLE_MIN_S
+        Log_Append((uint8_t)((log_seq * 7) % 101));
+    }
+    image->next = log_seq;
+    memcpy(image->flash, log_flash, LOG_BYTES);
+    bench_finish();
+}
+
+// Um boot do firmware sobre a imagem: acha o fim do log e grava 'appends'
+static void log_boot(int appends)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        failures = 0;
+        boot_appends = appends;
+        sim_run(log_boot_entry, SIM_NEVER);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "boot falhou");
+}
+
+// Registro 'seq' intacto na sua posição, com o valor gravado por log_boot
+static int log_present(uint16_t seq)
+{
+    const uint16_t *w = (const uint16_t *)(image->flash + (seq % LOG_CAPACITY) * 8);
+    uint8_t value = (uint8_t)(w[2] >> 8) & 0x7F;
+    return w[0] == seq && w[3] == (uint16_t)~(w[0] + w[1] + w[2]) &&
+           value == (seq * 7) % 101;
+}
+
+// Falta de energia no meio da próxima gravação: o segmento já foi apagado
+// se ela o abria, e só as duas primeiras palavras chegaram à flash
+static void log_tear(void)
+{
+    uint16_t pos = image->next % LOG_CAPACITY;
+    uint16_t *w = (uint16_t *)(image->flash + pos * 8);
+    if (pos % LOG_PER_SEGMENT == 0) memset(w, 0xFF, LOG_PER_SEGMENT * 8);
+    w[0] = image->next;
+    w[1] = 0x1234;
+}
+
+// Uma sequência de boots a partir do log zerado; cada passo grava
+// 'appends' registros e, com 'torn', é interrompido na gravação seguinte.
+// A cada boot o log retoma depois do último registro gravado (no máximo
+// até o segmento seguinte) e os registros da última volta continuam lá.
+typedef struct
+{
+    int appends;
+    int torn;
+} log_step_t;
+
+static void log_sequence(const char *name, const log_step_t *step, int steps)
+{
+    static uint8_t written[65536];
+    int32_t last = -1;
+    int i, lost = 0, back = 0;
+    uint32_t s;
+
+    memset(image, 0, sizeof(*image));   // Firmware recém-gravado: log zerado
+    memset(written, 0, sizeof(written));
+    for (i = 0; i < steps; i++)
+    {
+        log_boot(step[i].appends);
+        if (last >= 0)
+        {
+            uint16_t skip = (uint16_t)(image->recovered - last - 1);
+            if (skip >= LOG_PER_SEGMENT) back++;
+            // Os novos registros do boot já apagaram os mais antigos
+            uint32_t end = last + 1 + (uint16_t)(image->next - last - 1);
+            for (s = end > LOG_CAPACITY - 2 * LOG_PER_SEGMENT
+                         ? end - (LOG_CAPACITY - 2 * LOG_PER_SEGMENT) : 0;
+                 s <= (uint32_t)last; s++)
+                if (written[s] && !log_present((uint16_t)s)) lost++;
+        }
+        for (s = image->recovered; s != image->next; s = (uint16_t)(s + 1))
+        {
+            written[s] = 1;
+            last = s;
+        }
+        if (step[i].torn) log_tear();
+    }
+    CHECK(back == 0, "%s: %d boots retomaram antes do fim do log", name, back);
+    CHECK(lost == 0, "%s: %d registros perdidos", name, lost);
+    printf("  %s: %d boots, log_seq final %5u, %d perdidos\n", name, steps, image->next,
+           lost);
+}
+
+#define LOG_SEQUENCE(name, ...)                                                   \
+    do                                                                            \
+    {                                                                             \
+        static const log_step_t seq_[] = { __VA_ARGS__ };                         \
+        log_sequence(name, seq_, (int)(sizeof(seq_) / sizeof(seq_[0])));         \
+    } while (0)
+
+static void log_map(void)
+{
+    image = mmap(0, sizeof(*image), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (image == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(1);
+    }
+}
+
+static void test_log_torn(void)
+{
+    log_map();
+
+    // Uma gravação interrompida e dois resets depois dela
+    LOG_SEQUENCE("meio de segmento", { 96, 1 }, { 50, 0 }, { 1, 0 });
+    LOG_SEQUENCE("fica no segmento", { 40, 1 }, { 10, 0 }, { 1, 0 });
+    LOG_SEQUENCE("primeira posição", { 128, 1 }, { 70, 0 }, { 1, 0 });
+    LOG_SEQUENCE("última posição", { 127, 1 }, { 5, 0 }, { 1, 0 });
+    LOG_SEQUENCE("resets sem gravar", { 96, 1 }, { 0, 0 }, { 0, 1 }, { 0, 0 }, { 10, 0 });
+    // Interrupções em voltas seguidas do anel: o buraco deixado pelo salto
+    // antigo (até a próxima posição limpa) fazia a busca parar antes dele
+    LOG_SEQUENCE("várias voltas", { 1357, 1 }, { 566, 1 }, { 123, 1 }, { 117, 1 },
+                 { 543, 0 }, { 562, 0 }, { 1, 0 });
+}
+
+// O boot relê só o fim do log: cada registro relido avança o relógio do
+// histórico em 600 s, então o relógio refeito conta quantos foram. Com o
+// anel quase cheio são os mesmos LOG_REPLAY_MAX (288) de um log com 288,
+// e a janela sai igual às últimas leituras.
+static void test_log_replay(void)
+{
+    static const int fill[] = { 10, 288, 600, 2040 };
+    int i;
+
+    log_map();
+    for (i = 0; i < 4; i++)
+    {
+        int n = fill[i] < 24 ? fill[i] : 24;  // HISTORY_SIZE
+        int replay = fill[i] < 288 ? fill[i] : 288;
+        uint32_t sum = 0;
+        int s;
+
+        memset(image, 0, sizeof(*image));
+        log_boot(fill[i]);
+        log_boot(0);
+        for (s = fill[i] - n; s < fill[i]; s++) sum += (s * 7) % 101;
+
+        int replayed = (int)(image->clock_s / 600) + 1;
+        CHECK(replayed == replay, "%d registros: %d relidos, esperados %d", fill[i], replayed,
+              replay);
+        CHECK(image->window == n, "%d registros: janela com %u leituras", fill[i], image->window);
+        CHECK(image->mean == (sum + n / 2) / n, "%d registros: média %u, esperada %u", fill[i],
+              image->mean, (sum + n / 2) / n);
+        printf("  %4d registros no log: %3d relidos, %2u na janela\n", fill[i], replayed,
+               image->window);
+    }
+}
+
+/*
+ * EXECUÇÃO
+ */
+
+static const struct
+{
+    const char *name;
+    void (*run)(void);
+} tests[] = {
+    { "lcd_update", test_lcd_update },
+    { "stats", test_stats },
+    { "adc_reduce", test_adc_reduce },
+    { "cal", test_cal },
+    { "archive", test_archive },
+    { "log_torn", test_log_torn },
+    { "log_replay", test_log_replay },
+};
+#define NTESTS (int)(sizeof(tests) / sizeof(tests[0]))
+
+static void (*current)(void);
+
+static void entry(void)
+{
+    current();
+    bench_finish();
+}
+
+int main(int argc, char **argv)
+{
+    int i, ran = 0, failed = 0;
+
+    for (i = 0; i < NTESTS; i++)
+    {
+        if (argc > 1 && strcmp(argv[1], tests[i].name) != 0) continue;
+        printf("%s\n", tests[i].name);
+        fflush(stdout);
+        ran++;
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0)
+        {
+            current = tests[i].run;
+            sim_run(entry, SIM_NEVER);
+        }
+
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            printf("  %s: FALHOU\n", tests[i].name);
+            failed++;
+        }
+    }
+    printf("%d de %d testes falharam\n", failed, ran);
+    return failed != 0;
+}
@@ -0,0 +1,346 @@
+/*
+ * EXPANSOR DO LOG TOKENIZADO
+ *
+ * O ProjetoFinal.c grava cada TRACE como o número da linha (token) e os
+ * argumentos crus (ver LOG TOKENIZADO). Esta ferramenta gera do fonte o
+ * dicionário linha -> formato e, com ele, devolve os registros em texto,
+ * um por linha: dos quadros que saem pela UART de backchannel (misturados
+ * com telemetria e despejos de texto, que são ignorados) ou de um despejo
+ * binário da variável trace feito pelo depurador.
+ *
+ * Uso: ./trace -g ../ProjetoFinal.c > trace.dict   gera o dicionário
+ *      ./trace -h trace.dict > trace_dict.h        TRACE_DICT_ID do firmware
+ *      ./trace trace.dict [arquivo]                quadros da UART (ou stdin)
+ *      ./trace -m trace.dict ram.bin               despejo de trace (trace_t)
+ *      ./bench -s dry_spell -u uart.bin && ./trace trace.dict uart.bin
+ *
+ * O dicionário só vale para o fonte que gerou o firmware: os tokens são
+ * números de linha. Por isso ele termina com o seu hash (linha "id"), que
+ * o firmware compila como TRACE_DICT_ID e manda em cada quadro e no
+ * trace_t; registros de outro dicionário são recusados. Formatos aceitos: %d %i %u %x %X %c, com flags e
+ * largura; com l (%lu...) o valor ocupa dois argumentos (TRACE_U32).
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_SYNC     0xA6
+#define TRACE_VERSION  2
+#define TRACE_HEADER   11
+#define TRACE_MAX      (255 + 4)   // Quadro com o maior payload possível
+#define LINES_MAX      65536
+
+static char *dict[LINES_MAX];      // Formato de cada linha do fonte
+static uint16_t dict_id;           // Hash do dicionário (TRACE_DICT_ID)
+static unsigned long rejected;     // Quadros de outro dicionário
+static uint16_t rejected_id;
+
+static uint16_t crc16_update(uint16_t crc, uint8_t byte)
+{
+    int i;
+    crc ^= (uint16_t)byte << 8;
+    for (i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    return crc;
+}
+
+static uint32_t get_le(const uint8_t *p, int bytes)
+{
+    uint32_t v = 0;
+    while (bytes--) v = (v << 8) | p[bytes];
+    return v;
+}
+
+/* * DICIONÁRIO * */
+
+// Literal que começa em s (logo depois da aspa), como está no fonte
+static int literal(const char *s, char *out, size_t size)
+{
+    size_t n = 0;
+    while (*s && *s != '"' && n + 2 < size)
+    {
+        if (*s == '\\' && s[1]) out[n++] = *s++;
+        out[n++] = *s++;
+    }
+    out[n] = '\0';
+    return *s == '"';
+}
+
+// Uma linha "número<TAB>formato" por TRACE/TRACE0 com formato literal e,
+// no fim, "id<TAB>hash": CRC-16 das linhas anteriores, nunca 0 (o firmware
+// compilado sem trace_dict.h)
+static int generate(const char *path)
+{
+    static const char *const macros[] = { "TRACE(\"", "TRACE0(\"" };
+    FILE *in = fopen(path, "r");
+    char line[1024], fmt[1024], out[1100];
+    unsigned long n = 0;
+    uint16_t crc = 0xFFFF;
+    int m, i;
+
+    if (!in)
+    {
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in))
+    {
+        n++;
+        for (m = 0; m < 2; m++)
+        {
+            const char *p = strstr(line, macros[m]);
+            if (!p || (p > line && (p[-1] == '_' || (p[-1] >= 'A' && p[-1] <= 'Z')))) continue;
+            if (literal(p + strlen(macros[m]), fmt, sizeof(fmt)))
+            {
+                snprintf(out, sizeof(out), "%lu\t%s\n", n, fmt);
+                for (i = 0; out[i]; i++) crc = crc16_update(crc, (uint8_t)out[i]);
+                fputs(out, stdout);
+            }
+            break;
+        }
+    }
+    fclose(in);
+    printf("id\t0x%04x\n", crc ? crc : 1);
+    return 0;
+}
+
+// Cabeçalho que o firmware inclui para mandar o id do dicionário
+static int header(void)
+{
+    if (!dict_id)
+    {
+        fprintf(stderr, "trace: dicionário sem linha id (gere de novo com -g)\n");
+        return 1;
+    }
+    printf("/* Gerado por host/trace -h: hash do trace.dict deste fonte */\n");
+    printf("#define TRACE_DICT_ID 0x%04x\n", dict_id);
+    return 0;
+}
+
+// Desfaz os escapes do literal (\n, \t, \\, \")
+static char *unescape(const char *s)
+{
+    char *out = malloc(strlen(s) + 1), *o = out;
+    for (; *s; s++)
+    {
+        if (*s != '\\' || !s[1]) { *o++ = *s; continue; }
+        s++;
+        *o++ = *s == 'n' ? '\n' : *s == 't' ? '\t' : *s;
+    }
+    *o = '\0';
+    return out;
+}
+
+static int load(const char *path)
+{
+    FILE *in = fopen(path, "r");
+    char line[1100];
+
+    if (!in)
+    {
+        perror(path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), in))
+    {
+        char *tab = strchr(line, '\t');
+        unsigned long n = strtoul(line, 0, 10);
+        if (!strncmp(line, "id\t", 3)) dict_id = (uint16_t)strtoul(line + 3, 0, 16);
+        if (!tab || n >= LINES_MAX) continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        dict[n] = unescape(tab + 1);
+    }
+    fclose(in);
+    return 1;
+}
+
+/* * EXPANSÃO * */
+
+// Imprime o formato do token com os argumentos; argumento faltando vira ?
+static void expand(uint16_t token, const uint16_t *args, int n)
+{
+    const char *f = dict[token];
+    int a = 0;
+
+    if (!f)
+    {
+        printf("token %u?", token);
+        while (a < n) printf(" %u", args[a++]);
+        return;
+    }
+    while (*f)
+    {
+        char spec[16];
+        int len = 0, wide = 0;
+
+        if (*f != '%') { putchar(*f++); continue; }
+        if (f[1] == '%') { putchar('%'); f += 2; continue; }
+
+        spec[len++] = *f++;
+        while (*f && strchr("-+ #0123456789", *f) && len < 10) spec[len++] = *f++;
+        if (*f == 'l') { wide = 1; spec[len++] = *f++; }
+        if (!*f) break;
+        spec[len++] = *f;
+        spec[len] = '\0';
+
+        if (a + wide >= n) printf("?");
+        else if (wide)
+        {
+            uint32_t v = args[a] | (uint32_t)args[a + 1] << 16;
+            if (*f == 'd' || *f == 'i') printf(spec, (long)(int32_t)v);
+            else printf(spec, (unsigned long)v);
+        }
+        else if (*f == 'd' || *f == 'i') printf(spec, (int)(int16_t)args[a]);
+        else printf(spec, (unsigned)args[a]);
+        a += 1 + wide;
+        f++;
+    }
+}
+
+// Registros em r[0..len-1] (posição i lida por at(i)); devolve quantos
+static unsigned long records(const uint8_t *r, int len, int mask, int start, const char *prefix)
+{
+    unsigned long count = 0;
+    int i = 0;
+
+    while (i + 3 <= len)
+    {
+        uint16_t args[127];
+        uint16_t token = r[(start + i) & mask] | r[(start + i + 1) & mask] << 8;
+        int n = r[(start + i + 2) & mask], k;
+
+        i += 3;
+        if (i + 2 * n > len) break;
+        for (k = 0; k < n; k++, i += 2)
+            args[k] = r[(start + i) & mask] | r[(start + i + 1) & mask] << 8;
+        printf("%s", prefix);
+        expand(token, args, n);
+        putchar('\n');
+        count++;
+    }
+    return count;
+}
+
+// Quadro completo em f[0..TRACE_HEADER + 5 + registros]; 0 se não for válido.
+// Um quadro de outro dicionário é consumido sem expandir.
+static int decode(const uint8_t *f, int len, unsigned long *count)
+{
+    uint16_t crc = 0xFFFF;
+    char prefix[32];
+    int i;
+
+    if (len < f[1] + 4) return -1;  // Incompleto
+    if (f[1] < TRACE_HEADER || f[2] != TRACE_VERSION) return 0;
+    for (i = 1; i < f[1] + 2; i++) crc = crc16_update(crc, f[i]);
+    if (crc != get_le(f + f[1] + 2, 2)) return 0;
+
+    const uint8_t *p = f + 2;
+    if (get_le(p + 1, 2) != dict_id)
+    {
+        rejected++;
+        rejected_id = get_le(p + 1, 2);
+        return 1;
+    }
+    snprintf(prefix, sizeof(prefix), "%u ", get_le(p + 5, 4));
+    if (get_le(p + 9, 2)) printf("%s(%u registros perdidos)\n", prefix, get_le(p + 9, 2));
+    *count += records(p + TRACE_HEADER, f[1] - TRACE_HEADER, 0xFFFF, 0, prefix);
+    return 1;
+}
+
+// Registros de outro dicionário não são expandidos: sairiam em texto errado
+static int mismatch(void)
+{
+    if (!rejected) return 0;
+    fprintf(stderr, "trace: %lu quadros recusados: firmware com dicionário 0x%04x, este é 0x%04x\n",
+            rejected, rejected_id, dict_id);
+    return 1;
+}
+
+static int stream(FILE *in)
+{
+    uint8_t win[TRACE_MAX];
+    int len = 0, c, r;
+    unsigned long frames = 0, count = 0, skipped = 0;
+
+    // Janela deslizante como em telemetry.c, com tamanho vindo do quadro
+    while ((c = fgetc(in)) != EOF)
+    {
+        win[len++] = (uint8_t)c;
+        if (win[0] != TRACE_SYNC)
+        {
+            len = 0;
+            skipped++;
+            continue;
+        }
+        if (len < 2 || (r = decode(win, len, &count)) < 0) continue;
+        if (r)
+        {
+            frames++;
+            len = 0;
+            continue;
+        }
+
+        int i = 1;
+        while (i < len && win[i] != TRACE_SYNC) i++;
+        skipped += i;
+        for (c = i; c < len; c++) win[c - i] = win[c];
+        len -= i;
+    }
+
+    fprintf(stderr, "trace: %lu quadros, %lu registros, %lu bytes ignorados\n", frames, count,
+            skipped);
+    return mismatch();
+}
+
+// trace_t: dict u16, head u8, tail u8, dropped u16, anel (o resto do arquivo)
+static int memory(FILE *in)
+{
+    uint8_t buf[6 + 128];
+    size_t size = fread(buf, 1, sizeof(buf), in);
+    int ring = (int)size - 6;
+
+    if (size < 6 || (ring & (ring - 1)))
+    {
+        fprintf(stderr, "trace: despejo de %zu bytes não é um trace_t\n", size);
+        return 1;
+    }
+    if (get_le(buf, 2) != dict_id)
+    {
+        fprintf(stderr, "trace: despejo com dicionário 0x%04x, este é 0x%04x\n", get_le(buf, 2),
+                dict_id);
+        return 1;
+    }
+    if (get_le(buf + 4, 2)) printf("(%u registros perdidos)\n", get_le(buf + 4, 2));
+    records(buf + 6, (uint8_t)(buf[2] - buf[3]), ring - 1, buf[3], "");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    int mem = 0, r;
+
+    if (argc == 3 && !strcmp(argv[1], "-g")) return generate(argv[2]);
+    if (argc == 3 && !strcmp(argv[1], "-h")) return load(argv[2]) ? header() : 1;
+    if (argc > 1 && !strcmp(argv[1], "-m"))
+    {
+        mem = 1;
+        argv++;
+        argc--;
+    }
+    if (argc < 2 || (mem && argc < 3))
+    {
+        fprintf(stderr, "uso: %s -g fonte.c | -h dicionário | [-m] dicionário [arquivo]\n", argv[0]);
+        return 1;
+    }
+    if (!load(argv[1])) return 1;
+    if (argc > 2 && !(in = fopen(argv[2], "rb")))
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    r = mem ? memory(in) : stream(in);
+    if (in != stdin) fclose(in);
+    return r;
+}